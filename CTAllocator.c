@@ -6,75 +6,1435 @@
 //  Copyright (c) 2013 Carlo Tortorella. All rights reserved.
 //
 
+#define _GNU_SOURCE
+#ifdef CTALLOCATOR_PROFILE
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include "CTAllocator.h"
 
+/**
+ * Every block handed out by a CTAllocator is preceded by one of these. For blocks allocated individually the index is the block's slot in the allocator's objects array, which lets deallocation and reallocation find it without a search. Small size-class blocks have an index of CT_NOT_FOUND, and blocks carved out of an arena's chunks have an index of kArenaIndex. Blocks that belong to a scope have an index of kScopedIndex and are preceded by a link in the scope's list, and blocks carved out of a CTAllocatorRegion have an index of kRegionIndex.
+ * alignment is the log2 of the alignment the block was requested with, and offset is the distance in 16 byte units from the memory returned by malloc to the block's bytes, so aligned blocks can still be passed to realloc and free. Large individually allocated blocks are mapped straight from the operating system instead and have mapped set.
+ **/
+typedef struct
+{
+	uint64_t index;
+	uint64_t size : 44;
+	uint64_t alignment : 7;
+	uint64_t mapped : 1;
+	uint64_t offset : 12;
+} CTAllocatorBlock;
+
+/**
+ * A chunk of memory that arena blocks and small size-class blocks are carved out of.
+ **/
+struct CTAllocatorChunk
+{
+	struct CTAllocatorChunk * next;
+	uint64_t size;
+	uint64_t used;
+	uint64_t reserved;
+};
+
+#define CTALLOCATOR_CACHE_CAPACITY 0x40
+#define CTALLOCATOR_THREAD_CACHES 8
+
+/**
+ * A per-thread cache of free small blocks for a shared allocator, so that most allocations and deallocations never touch the allocator's lock.
+ **/
+struct CTAllocatorCache
+{
+	struct CTAllocatorCache * next;
+	CTAllocatorScope * scope;
+	CTAllocatorStats stats;
+	uint64_t counts[CTALLOCATOR_SIZE_CLASSES];
+	CTAllocatorBlock * blocks[CTALLOCATOR_SIZE_CLASSES][CTALLOCATOR_CACHE_CAPACITY];
+};
+
+struct CTAllocatorShared
+{
+	pthread_mutex_t lock;
+	uint64_t identifier;
+	uint64_t scopes;
+	struct CTAllocatorCache * caches;
+};
+
+typedef struct CTAllocatorScopeLink CTAllocatorLink;
+
+static const uint64_t kChunkInitialSize = 0x1000;
+static const uint64_t kChunkMaximumSize = 0x40000;
+static const uint64_t kSizeClassGranularity = 0x10;
+static const uint64_t kMinimumAlignment = 0x10;
+static const uint64_t kMaximumAlignment = 0x1000;
+static const uint64_t kMapThreshold = 0x40000;
+static const uint64_t kHugePageSize = 0x200000;
+static const uint64_t kSmallBlockLimit = 0x10 * CTALLOCATOR_SIZE_CLASSES;
+static const uint64_t kCacheRefill = CTALLOCATOR_CACHE_CAPACITY / 2;
+static const uint64_t kScopedIndex = CT_NOT_FOUND - 1;
+static const uint64_t kRegionIndex = CT_NOT_FOUND - 2;
+static const uint64_t kArenaIndex = CT_NOT_FOUND - 3;
+
+static uint64_t CTAllocatorSharedCount = 0;
+static __thread struct
+{
+	uint64_t identifier;
+	struct CTAllocatorCache * cache;
+} CTAllocatorThreadCaches[CTALLOCATOR_THREAD_CACHES];
+static __thread uint64_t CTAllocatorThreadCacheVictim = 0;
+
+static inline uint64_t CTAllocatorAlign(uint64_t size)
+{
+	return (size + 0xF) & ~(uint64_t)0xF;
+}
+
+static inline char * CTAllocatorAlignPointer(char * ptr, uint64_t alignment)
+{
+	return (char *)(((uintptr_t)ptr + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+static uint64_t CTAllocatorPageAlign(uint64_t size)
+{
+	static uint64_t page = 0;
+	if (!page)
+	{
+		page = sysconf(_SC_PAGESIZE);
+	}
+	return (size + page - 1) & ~(page - 1);
+}
+
+static char * CTAllocatorMapPages(uint64_t length)
+{
+	char * pages = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	assert(pages != MAP_FAILED);
+#ifdef MADV_HUGEPAGE
+	if (length >= kHugePageSize)
+	{
+		madvise(pages, length, MADV_HUGEPAGE);
+	}
+#endif
+	return pages;
+}
+
+static void * CTAllocatorBackendAllocate(CTAllocatorRef restrict allocator, uint64_t size, CTAllocatorOptions options)
+{
+	void * ptr = NULL;
+	if (allocator->backend.allocate)
+	{
+		ptr = allocator->backend.allocate(allocator->backend.context, size);
+		if (ptr && !(options & CTAllocatorOptionsUninitialised))
+		{
+			memset(ptr, 0, size);
+		}
+	}
+	else
+	{
+		ptr = options & CTAllocatorOptionsUninitialised ? malloc(size) : calloc(1, size);
+	}
+	assert(ptr);
+	return ptr;
+}
+
+static void * CTAllocatorBackendReallocate(CTAllocatorRef restrict allocator, void * ptr, uint64_t old_size, uint64_t size)
+{
+	ptr = allocator->backend.reallocate ? allocator->backend.reallocate(allocator->backend.context, ptr, old_size, size) : realloc(ptr, size);
+	assert(ptr);
+	return ptr;
+}
+
+static void CTAllocatorBackendDeallocate(CTAllocatorRef restrict allocator, void * ptr, uint64_t size)
+{
+	if (allocator->backend.deallocate)
+	{
+		allocator->backend.deallocate(allocator->backend.context, ptr, size);
+	}
+	else
+	{
+		free(ptr);
+	}
+}
+
+static inline uint8_t CTAllocatorShouldMap(CTAllocatorRef restrict allocator, uint64_t size)
+{
+	// Custom backends own all of the allocator's memory, large blocks included
+	return !allocator->backend.allocate && size >= kMapThreshold;
+}
+
+static inline uint64_t CTAllocatorNormaliseAlignment(uint64_t alignment)
+{
+	assert(!(alignment & (alignment - 1)) && alignment <= kMaximumAlignment);
+	return alignment > kMinimumAlignment ? alignment : kMinimumAlignment;
+}
+
+static inline uint64_t CTAllocatorSizeClass(uint64_t size)
+{
+	return size ? (size - 1) / kSizeClassGranularity : 0;
+}
+
+static inline uint64_t CTAllocatorSizeClassCapacity(uint64_t size_class)
+{
+	return (size_class + 1) * kSizeClassGranularity;
+}
+
+static inline void CTAllocatorLock(CTAllocatorRef restrict allocator)
+{
+	if (allocator->shared)
+	{
+		pthread_mutex_lock(&allocator->shared->lock);
+	}
+}
+
+static inline void CTAllocatorUnlock(CTAllocatorRef restrict allocator)
+{
+	if (allocator->shared)
+	{
+		pthread_mutex_unlock(&allocator->shared->lock);
+	}
+}
+
+static inline char * CTAllocatorChunkBytes(struct CTAllocatorChunk * chunk)
+{
+	return (char *)(chunk + 1);
+}
+
+static inline void CTAllocatorBlockInitialise(CTAllocatorBlock * block, uint64_t index, uint64_t size, uint64_t alignment, uint64_t offset)
+{
+	block->index = index;
+	block->size = size;
+	block->alignment = __builtin_ctzll(alignment);
+	block->mapped = 0;
+	block->offset = offset / 0x10;
+}
+
+static inline uint64_t CTAllocatorBlockAlignment(const CTAllocatorBlock * block)
+{
+	return 1ULL << block->alignment;
+}
+
+static inline char * CTAllocatorBlockBase(CTAllocatorBlock * block)
+{
+	return (char *)(block + 1) - block->offset * 0x10;
+}
+
+static inline uint64_t CTAllocatorBlockIndex(const CTAllocatorBlock * block)
+{
+	// Shared allocators rewrite the index of individually allocated blocks from other threads, but never to or from CT_NOT_FOUND, kScopedIndex, kRegionIndex or kArenaIndex
+	return __atomic_load_n(&block->index, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t CTAllocatorBlockMappedLength(const CTAllocatorBlock * block)
+{
+	return CTAllocatorPageAlign(CTAllocatorBlockAlignment(block) + block->size);
+}
+
+static void CTAllocatorFreeBlock(CTAllocatorRef restrict allocator, CTAllocatorBlock * block)
+{
+	if (block->mapped)
+	{
+		munmap(CTAllocatorBlockBase(block), CTAllocatorBlockMappedLength(block));
+	}
+	else
+	{
+		CTAllocatorBackendDeallocate(allocator, CTAllocatorBlockBase(block), CTAllocatorBlockAlignment(block) + block->size);
+	}
+}
+
+static inline uint8_t CTAllocatorBlockIsSmall(const CTAllocatorBlock * block)
+{
+	return CTAllocatorBlockIndex(block) == CT_NOT_FOUND;
+}
+
+static inline uint8_t CTAllocatorBlockIsScoped(const CTAllocatorBlock * block)
+{
+	return CTAllocatorBlockIndex(block) == kScopedIndex;
+}
+
+static inline uint8_t CTAllocatorBlockIsInRegion(const CTAllocatorBlock * block)
+{
+	return CTAllocatorBlockIndex(block) == kRegionIndex;
+}
+
+static inline CTAllocatorBlock * CTAllocatorBlockForPointer(CTAllocatorRef restrict allocator, void * ptr)
+{
+	CTAllocatorBlock * block = (CTAllocatorBlock *)ptr - 1;
+	if (block->index < allocator->count && allocator->objects[block->index] == block)
+	{
+		return block;
+	}
+	return NULL;
+}
+
+static struct CTAllocatorChunk * CTAllocatorAddChunk(CTAllocatorRef restrict allocator, uint64_t minimum)
+{
+	struct CTAllocatorChunk * chunk = allocator->spare;
+	if (chunk && chunk->size >= minimum)
+	{
+		allocator->spare = chunk->next;
+	}
+	else
+	{
+		uint64_t size = allocator->chunks ? allocator->chunks->size * 2 : kChunkInitialSize;
+		if (size > kChunkMaximumSize)
+		{
+			size = kChunkMaximumSize;
+		}
+		if (size < minimum)
+		{
+			size = minimum;
+		}
+		if (size > kChunkMaximumSize && CTAllocatorShouldMap(allocator, size))
+		{
+			chunk = (struct CTAllocatorChunk *)CTAllocatorMapPages(CTAllocatorPageAlign(sizeof(struct CTAllocatorChunk) + size));
+		}
+		else
+		{
+			chunk = CTAllocatorBackendAllocate(allocator, sizeof(struct CTAllocatorChunk) + size, CTAllocatorOptionsUninitialised);
+		}
+		chunk->size = size;
+	}
+	chunk->used = 0;
+
+	if (allocator->chunks && chunk->size > kChunkMaximumSize)
+	{
+		// Oversized chunks hold a single block, so keep bumping from the current chunk
+		chunk->next = allocator->chunks->next;
+		allocator->chunks->next = chunk;
+	}
+	else
+	{
+		chunk->next = allocator->chunks;
+		allocator->chunks = chunk;
+	}
+	return chunk;
+}
+
+static inline uint64_t CTAllocatorChunkPadding(struct CTAllocatorChunk * chunk, uint64_t alignment)
+{
+	char * ptr = CTAllocatorChunkBytes(chunk) + chunk->used + sizeof(CTAllocatorBlock);
+	return CTAllocatorAlignPointer(ptr, alignment) - ptr;
+}
+
+static CTAllocatorBlock * CTAllocatorCarve(CTAllocatorRef restrict allocator, uint64_t total, uint64_t alignment)
+{
+	struct CTAllocatorChunk * chunk = allocator->chunks;
+	uint64_t padding = chunk ? CTAllocatorChunkPadding(chunk, alignment) : 0;
+	if (!chunk || chunk->used + padding + total > chunk->size)
+	{
+		chunk = CTAllocatorAddChunk(allocator, total + alignment - kMinimumAlignment);
+		padding = CTAllocatorChunkPadding(chunk, alignment);
+	}
+	CTAllocatorBlock * block = (CTAllocatorBlock *)(CTAllocatorChunkBytes(chunk) + chunk->used + padding);
+	chunk->used += padding + total;
+	return block;
+}
+
+static void CTAllocatorFreeChunk(CTAllocatorRef restrict allocator, struct CTAllocatorChunk * chunk)
+{
+	if (chunk->size > kChunkMaximumSize && CTAllocatorShouldMap(allocator, chunk->size))
+	{
+		munmap(chunk, CTAllocatorPageAlign(sizeof(struct CTAllocatorChunk) + chunk->size));
+	}
+	else
+	{
+		CTAllocatorBackendDeallocate(allocator, chunk, sizeof(struct CTAllocatorChunk) + chunk->size);
+	}
+}
+
+static void CTAllocatorEmptyChunks(CTAllocatorRef restrict allocator)
+{
+	for (struct CTAllocatorChunk * chunk = allocator->chunks, * next; chunk; chunk = next)
+	{
+		next = chunk->next;
+		if (chunk->size > kChunkMaximumSize)
+		{
+			// Oversized chunks are mapped for a single block and not worth keeping
+			CTAllocatorFreeChunk(allocator, chunk);
+		}
+		else
+		{
+			chunk->next = allocator->spare;
+			allocator->spare = chunk;
+		}
+	}
+	allocator->chunks = NULL;
+	memset(allocator->free_blocks, 0, sizeof(allocator->free_blocks));
+}
+
+static void CTAllocatorFreeChunks(CTAllocatorRef restrict allocator, struct CTAllocatorChunk * chunk)
+{
+	for (struct CTAllocatorChunk * next; chunk; chunk = next)
+	{
+		next = chunk->next;
+		CTAllocatorFreeChunk(allocator, chunk);
+	}
+}
+
+static inline CTAllocatorBlock * CTAllocatorPopFreeBlock(CTAllocatorRef restrict allocator, uint64_t size_class)
+{
+	CTAllocatorBlock * block = allocator->free_blocks[size_class];
+	if (block)
+	{
+		allocator->free_blocks[size_class] = *(CTAllocatorBlock **)(block + 1);
+	}
+	else
+	{
+		block = CTAllocatorCarve(allocator, sizeof(CTAllocatorBlock) + CTAllocatorSizeClassCapacity(size_class), kMinimumAlignment);
+	}
+	return block;
+}
+
+static inline void CTAllocatorPushFreeBlock(CTAllocatorRef restrict allocator, CTAllocatorBlock * block, uint64_t size_class)
+{
+	*(CTAllocatorBlock **)(block + 1) = allocator->free_blocks[size_class];
+	allocator->free_blocks[size_class] = block;
+}
+
+static struct CTAllocatorCache * CTAllocatorThreadCache(CTAllocatorRef restrict allocator)
+{
+	uint64_t identifier = allocator->shared->identifier;
+	for (uint64_t i = 0; i < CTALLOCATOR_THREAD_CACHES; ++i)
+	{
+		if (CTAllocatorThreadCaches[i].identifier == identifier)
+		{
+			return CTAllocatorThreadCaches[i].cache;
+		}
+	}
+	
+	// Any cache evicted from the thread's table stays registered with its allocator, its blocks are reclaimed by CTAllocatorEmpty
+	struct CTAllocatorCache * cache = calloc(1, sizeof(struct CTAllocatorCache));
+	assert(cache);
+	CTAllocatorLock(allocator);
+	cache->next = allocator->shared->caches;
+	allocator->shared->caches = cache;
+	CTAllocatorUnlock(allocator);
+	uint64_t slot = CTAllocatorThreadCacheVictim++ % CTALLOCATOR_THREAD_CACHES;
+	CTAllocatorThreadCaches[slot].identifier = identifier;
+	CTAllocatorThreadCaches[slot].cache = cache;
+	return cache;
+}
+
+// Statistics are only ever written by one thread, the atomics keep concurrent readers in CTAllocatorGetStats well defined
+#define CTAllocatorStatsAdd(FIELD, DELTA) \
+	__atomic_store_n(&(FIELD), __atomic_load_n(&(FIELD), __ATOMIC_RELAXED) + (DELTA), __ATOMIC_RELAXED)
+
+static inline uint64_t CTAllocatorHistogramBucket(uint64_t size)
+{
+	if (size <= 0x10)
+	{
+		return 0;
+	}
+	uint64_t bucket = 64 - __builtin_clzll(size - 1) - 4;
+	return bucket < CTALLOCATOR_HISTOGRAM_BUCKETS ? bucket : CTALLOCATOR_HISTOGRAM_BUCKETS - 1;
+}
+
+static inline CTAllocatorStats * CTAllocatorThreadStats(CTAllocatorRef restrict allocator)
+{
+	return allocator->shared ? &CTAllocatorThreadCache(allocator)->stats : &allocator->stats;
+}
+
+static inline void CTAllocatorUpdatePeak(CTAllocatorRef restrict allocator, CTAllocatorStats * stats)
+{
+	if (!allocator->shared && stats->live_bytes > stats->peak_bytes)
+	{
+		stats->peak_bytes = stats->live_bytes;
+	}
+}
+
+/**
+ * Sum the live bytes of every thread of a shared allocator into its peak, must be called with the lock held.
+ **/
+static void CTAllocatorSamplePeak(CTAllocatorRef restrict allocator)
+{
+	uint64_t live_bytes = 0;
+	for (struct CTAllocatorCache * cache = allocator->shared->caches; cache; cache = cache->next)
+	{
+		live_bytes += __atomic_load_n(&cache->stats.live_bytes, __ATOMIC_RELAXED);
+	}
+	if (live_bytes > allocator->stats.peak_bytes)
+	{
+		allocator->stats.peak_bytes = live_bytes;
+	}
+}
+
+static void CTAllocatorRecordAllocation(CTAllocatorRef restrict allocator, uint64_t size)
+{
+	CTAllocatorStats * stats = CTAllocatorThreadStats(allocator);
+	CTAllocatorStatsAdd(stats->allocations, 1);
+	CTAllocatorStatsAdd(stats->live_blocks, 1);
+	CTAllocatorStatsAdd(stats->live_bytes, size);
+	CTAllocatorStatsAdd(stats->histogram[CTAllocatorHistogramBucket(size)], 1);
+	CTAllocatorUpdatePeak(allocator, stats);
+}
+
+static void CTAllocatorRecordReallocation(CTAllocatorRef restrict allocator, uint64_t old_size, uint64_t size)
+{
+	CTAllocatorStats * stats = CTAllocatorThreadStats(allocator);
+	CTAllocatorStatsAdd(stats->reallocations, 1);
+	CTAllocatorStatsAdd(stats->live_bytes, size - old_size);
+	CTAllocatorStatsAdd(stats->histogram[CTAllocatorHistogramBucket(old_size)], -1);
+	CTAllocatorStatsAdd(stats->histogram[CTAllocatorHistogramBucket(size)], 1);
+	CTAllocatorUpdatePeak(allocator, stats);
+}
+
+static void CTAllocatorRecordDeallocation(CTAllocatorRef restrict allocator, uint64_t size)
+{
+	CTAllocatorStats * stats = CTAllocatorThreadStats(allocator);
+	CTAllocatorStatsAdd(stats->deallocations, 1);
+	CTAllocatorStatsAdd(stats->live_blocks, -1);
+	CTAllocatorStatsAdd(stats->live_bytes, -size);
+	CTAllocatorStatsAdd(stats->histogram[CTAllocatorHistogramBucket(size)], -1);
+}
+
+static void * CTAllocatorSmallAllocate(CTAllocatorRef restrict allocator, uint64_t size, CTAllocatorOptions options)
+{
+	uint64_t size_class = CTAllocatorSizeClass(size);
+	CTAllocatorBlock * block = NULL;
+	if (allocator->shared)
+	{
+		struct CTAllocatorCache * cache = CTAllocatorThreadCache(allocator);
+		if (!cache->counts[size_class])
+		{
+			CTAllocatorLock(allocator);
+			while (cache->counts[size_class] < kCacheRefill)
+			{
+				cache->blocks[size_class][cache->counts[size_class]++] = CTAllocatorPopFreeBlock(allocator, size_class);
+			}
+			CTAllocatorSamplePeak(allocator);
+			CTAllocatorUnlock(allocator);
+		}
+		block = cache->blocks[size_class][--cache->counts[size_class]];
+	}
+	else
+	{
+		block = CTAllocatorPopFreeBlock(allocator, size_class);
+	}
+	CTAllocatorBlockInitialise(block, CT_NOT_FOUND, size, kMinimumAlignment, 0);
+	if (!(options & CTAllocatorOptionsUninitialised))
+	{
+		memset(block + 1, 0, CTAllocatorSizeClassCapacity(size_class));
+	}
+	return block + 1;
+}
+
+static void CTAllocatorSmallDeallocate(CTAllocatorRef restrict allocator, CTAllocatorBlock * block)
+{
+	assert(block->size <= kSmallBlockLimit);
+	uint64_t size_class = CTAllocatorSizeClass(block->size);
+	if (allocator->shared)
+	{
+		struct CTAllocatorCache * cache = CTAllocatorThreadCache(allocator);
+		if (cache->counts[size_class] == CTALLOCATOR_CACHE_CAPACITY)
+		{
+			CTAllocatorLock(allocator);
+			while (cache->counts[size_class] > CTALLOCATOR_CACHE_CAPACITY - kCacheRefill)
+			{
+				CTAllocatorPushFreeBlock(allocator, cache->blocks[size_class][--cache->counts[size_class]], size_class);
+			}
+			CTAllocatorSamplePeak(allocator);
+			CTAllocatorUnlock(allocator);
+		}
+		cache->blocks[size_class][cache->counts[size_class]++] = block;
+	}
+	else
+	{
+		CTAllocatorPushFreeBlock(allocator, block, size_class);
+	}
+}
+
+static void * CTAllocatorArenaAllocate(CTAllocatorRef restrict allocator, uint64_t size, uint64_t alignment, CTAllocatorOptions options)
+{
+	uint64_t total = CTAllocatorAlign(sizeof(CTAllocatorBlock) + size);
+	CTAllocatorBlock * block = CTAllocatorCarve(allocator, total, alignment);
+	CTAllocatorBlockInitialise(block, kArenaIndex, size, alignment, 0);
+	if (!(options & CTAllocatorOptionsUninitialised))
+	{
+		memset(block + 1, 0, total - sizeof(CTAllocatorBlock));
+	}
+	return block + 1;
+}
+
+static void * CTAllocatorArenaReallocate(CTAllocatorRef restrict allocator, void * ptr, uint64_t size, uint64_t alignment, CTAllocatorOptions options)
+{
+	CTAllocatorBlock * block = (CTAllocatorBlock *)ptr - 1;
+	if (block->index != kArenaIndex)
+	{
+		return CTAllocatorArenaAllocate(allocator, size, alignment, options);
+	}
+	if (alignment < CTAllocatorBlockAlignment(block))
+	{
+		alignment = CTAllocatorBlockAlignment(block);
+	}
+	if (size <= block->size && alignment == CTAllocatorBlockAlignment(block))
+	{
+		block->size = size;
+		return ptr;
+	}
+
+	struct CTAllocatorChunk * chunk = allocator->chunks;
+	uint64_t total = CTAllocatorAlign(sizeof(CTAllocatorBlock) + block->size);
+	if (alignment == CTAllocatorBlockAlignment(block) && (char *)block + total == CTAllocatorChunkBytes(chunk) + chunk->used)
+	{
+		uint64_t new_total = CTAllocatorAlign(sizeof(CTAllocatorBlock) + size);
+		if (chunk->used - total + new_total <= chunk->size)
+		{
+			chunk->used = chunk->used - total + new_total;
+			block->size = size;
+			return ptr;
+		}
+	}
+
+	void * new_ptr = CTAllocatorArenaAllocate(allocator, size, alignment, options);
+	memcpy(new_ptr, ptr, block->size < size ? block->size : size);
+	return new_ptr;
+}
+
+#ifdef CTALLOCATOR_PROFILE
+#define CTALLOCATOR_PROFILE_DEPTH 24
+#define CTALLOCATOR_PROFILE_STACKS 0x1000
+
+/**
+ * A distinct call stack seen by the allocation profiler. samples and bytes are already scaled by the sampling rate.
+ **/
+struct CTAllocatorProfileStack
+{
+	uint64_t hash;
+	uint64_t depth;
+	uint64_t samples;
+	uint64_t bytes;
+	void * frames[CTALLOCATOR_PROFILE_DEPTH];
+};
+
+static pthread_mutex_t CTAllocatorProfileLock = PTHREAD_MUTEX_INITIALIZER;
+static struct CTAllocatorProfileStack CTAllocatorProfileStacks[CTALLOCATOR_PROFILE_STACKS];
+static uint64_t CTAllocatorProfileDropped = 0;
+static uint64_t CTAllocatorProfileRate = 0;
+static __thread int64_t CTAllocatorProfileCountdown = 0;
+
+static void CTAllocatorProfileRecord(uint64_t size, uint64_t rate)
+{
+	void * frames[CTALLOCATOR_PROFILE_DEPTH];
+	uint64_t depth = backtrace(frames, CTALLOCATOR_PROFILE_DEPTH);
+	uint64_t hash = 0xCBF29CE484222325;
+	for (uint64_t i = 0; i < depth; ++i)
+	{
+		hash = (hash ^ (uintptr_t)frames[i]) * 0x100000001B3;
+	}
+	hash |= 1;
+	
+	pthread_mutex_lock(&CTAllocatorProfileLock);
+	for (uint64_t i = 0; i < CTALLOCATOR_PROFILE_STACKS; ++i)
+	{
+		struct CTAllocatorProfileStack * stack = &CTAllocatorProfileStacks[(hash + i) & (CTALLOCATOR_PROFILE_STACKS - 1)];
+		if (!stack->hash)
+		{
+			stack->hash = hash;
+			stack->depth = depth;
+			memcpy(stack->frames, frames, sizeof(void *) * depth);
+		}
+		if (stack->hash == hash && stack->depth == depth && !memcmp(stack->frames, frames, sizeof(void *) * depth))
+		{
+			stack->samples += rate;
+			stack->bytes += size * rate;
+			pthread_mutex_unlock(&CTAllocatorProfileLock);
+			return;
+		}
+	}
+	++CTAllocatorProfileDropped;
+	pthread_mutex_unlock(&CTAllocatorProfileLock);
+}
+
+static inline void CTAllocatorProfileSample(uint64_t size)
+{
+	uint64_t rate = __atomic_load_n(&CTAllocatorProfileRate, __ATOMIC_RELAXED);
+	if (rate && --CTAllocatorProfileCountdown <= 0)
+	{
+		CTAllocatorProfileCountdown = rate;
+		CTAllocatorProfileRecord(size, rate);
+	}
+}
+
+static const char * CTAllocatorProfileSymbol(void * frame, char * buffer, uint64_t size)
+{
+	Dl_info info;
+	if (dladdr(frame, &info) && info.dli_sname)
+	{
+		return info.dli_sname;
+	}
+	snprintf(buffer, size, "%p", frame);
+	return buffer;
+}
+
+static uint64_t CTAllocatorProfileFirstFrame(const struct CTAllocatorProfileStack * stack)
+{
+	// Skip the profiler itself and the allocator's own entry points, so the stack ends at the function that asked for memory
+	uint64_t first = 1;
+	Dl_info info;
+	while (first + 1 < stack->depth && dladdr(stack->frames[first], &info) && info.dli_sname && !strncmp(info.dli_sname, "CTAllocator", strlen("CTAllocator")))
+	{
+		++first;
+	}
+	return first;
+}
+
+static int CTAllocatorProfileCompare(const void * a, const void * b)
+{
+	const struct CTAllocatorProfileStack * stack1 = a, * stack2 = b;
+	return stack1->bytes < stack2->bytes ? 1 : stack1->bytes > stack2->bytes ? -1 : 0;
+}
+#else
+#define CTAllocatorProfileSample(SIZE)
+#endif
+
+static CTAllocatorScope ** CTAllocatorCurrentScope(CTAllocatorRef restrict allocator)
+{
+	if (allocator->shared)
+	{
+		return __atomic_load_n(&allocator->shared->scopes, __ATOMIC_RELAXED) ? &CTAllocatorThreadCache(allocator)->scope : NULL;
+	}
+	return &allocator->scope;
+}
+
+static void * CTAllocatorScopedAllocate(CTAllocatorRef restrict allocator, CTAllocatorScope * scope, uint64_t size, uint64_t alignment, CTAllocatorOptions options)
+{
+	uint64_t total = sizeof(CTAllocatorLink) + alignment + size;
+	char * base = CTAllocatorBackendAllocate(allocator, total, options);
+	char * ptr = CTAllocatorAlignPointer(base + sizeof(CTAllocatorLink) + sizeof(CTAllocatorBlock), alignment);
+	CTAllocatorBlock * block = (CTAllocatorBlock *)ptr - 1;
+	CTAllocatorBlockInitialise(block, kScopedIndex, size, alignment, ptr - base);
+	CTAllocatorLink * link = (CTAllocatorLink *)block - 1;
+	CTAllocatorLock(allocator);
+	link->prev = &scope->blocks;
+	link->next = scope->blocks.next;
+	link->next->prev = link;
+	scope->blocks.next = link;
+	CTAllocatorUnlock(allocator);
+	return ptr;
+}
+
+static void CTAllocatorScopedDeallocate(CTAllocatorRef restrict allocator, CTAllocatorBlock * block)
+{
+	CTAllocatorLink * link = (CTAllocatorLink *)block - 1;
+	CTAllocatorLock(allocator);
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	CTAllocatorUnlock(allocator);
+	CTAllocatorBackendDeallocate(allocator, CTAllocatorBlockBase(block), sizeof(CTAllocatorLink) + CTAllocatorBlockAlignment(block) + block->size);
+}
+
+static void * CTAllocatorScopedReallocate(CTAllocatorRef restrict allocator, CTAllocatorBlock * block, uint64_t size, uint64_t alignment)
+{
+	uint64_t old_size = block->size;
+	uint64_t offset = block->offset * 0x10;
+	uint64_t header = sizeof(CTAllocatorLink) + sizeof(CTAllocatorBlock);
+	uint64_t old_total = sizeof(CTAllocatorLink) + CTAllocatorBlockAlignment(block) + old_size;
+	uint64_t total = sizeof(CTAllocatorLink) + (alignment > CTAllocatorBlockAlignment(block) ? alignment : CTAllocatorBlockAlignment(block)) + size;
+	CTAllocatorLock(allocator);
+	char * base = NULL;
+	if (alignment > CTAllocatorBlockAlignment(block))
+	{
+		base = CTAllocatorBackendAllocate(allocator, total, CTAllocatorOptionsUninitialised);
+		memcpy(base, CTAllocatorBlockBase(block), offset + (old_size < size ? old_size : size));
+		CTAllocatorBackendDeallocate(allocator, CTAllocatorBlockBase(block), old_total);
+	}
+	else
+	{
+		alignment = CTAllocatorBlockAlignment(block);
+		base = CTAllocatorBackendReallocate(allocator, CTAllocatorBlockBase(block), old_total, total);
+	}
+	char * ptr = CTAllocatorAlignPointer(base + header, alignment);
+	if (ptr != base + offset)
+	{
+		memmove(ptr - header, base + offset - header, header + (old_size < size ? old_size : size));
+	}
+	block = (CTAllocatorBlock *)ptr - 1;
+	CTAllocatorBlockInitialise(block, kScopedIndex, size, alignment, ptr - base);
+	CTAllocatorLink * link = (CTAllocatorLink *)block - 1;
+	link->prev->next = link;
+	link->next->prev = link;
+	CTAllocatorUnlock(allocator);
+	return ptr;
+}
+
+static void CTAllocatorFreeScope(CTAllocatorRef restrict allocator, CTAllocatorScope * scope, uint8_t record)
+{
+	for (CTAllocatorLink * link = scope->blocks.next, * next; link != &scope->blocks; link = next)
+	{
+		next = link->next;
+		CTAllocatorBlock * block = (CTAllocatorBlock *)(link + 1);
+		if (record)
+		{
+			CTAllocatorRecordDeallocation(allocator, block->size);
+		}
+		CTAllocatorBackendDeallocate(allocator, CTAllocatorBlockBase(block), sizeof(CTAllocatorLink) + CTAllocatorBlockAlignment(block) + block->size);
+	}
+	scope->blocks.next = scope->blocks.prev = &scope->blocks;
+}
+
+static void CTAllocatorResetLiveStats(CTAllocatorStats * stats)
+{
+	stats->live_blocks = 0;
+	stats->live_bytes = 0;
+	memset(stats->histogram, 0, sizeof(stats->histogram));
+	memset(stats->objects, 0, sizeof(stats->objects));
+}
+
 CTAllocatorRef CTAllocatorCreate()
 {
 	return calloc(1, sizeof(CTAllocator));
 }
 
+CTAllocatorRef CTAllocatorCreateWithBackend(const CTAllocatorBackend * backend)
+{
+	assert(backend && backend->allocate && backend->reallocate && backend->deallocate);
+	CTAllocatorRef allocator = CTAllocatorCreate();
+	allocator->backend = *backend;
+	return allocator;
+}
+
+CTAllocatorRef CTAllocatorCreateArena()
+{
+	CTAllocatorRef allocator = CTAllocatorCreate();
+	allocator->type = CTALLOCATOR_TYPE_ARENA;
+	return allocator;
+}
+
+CTAllocatorRef CTAllocatorCreateShared()
+{
+	CTAllocatorRef allocator = CTAllocatorCreate();
+	allocator->shared = calloc(1, sizeof(struct CTAllocatorShared));
+	assert(allocator->shared);
+	pthread_mutex_init(&allocator->shared->lock, NULL);
+	allocator->shared->identifier = __sync_add_and_fetch(&CTAllocatorSharedCount, 1);
+	return allocator;
+}
+
 void CTAllocatorEmpty(CTAllocatorRef restrict allocator)
 {
-	for (int i = 0; i < allocator->count; ++i)
+	CTAllocatorLock(allocator);
+	for (uint64_t i = 0; i < allocator->count; ++i)
 	{
-		free(allocator->objects[i]);
+		CTAllocatorFreeBlock(allocator, allocator->objects[i]);
 	}
 	allocator->count = 0;
+	CTAllocatorEmptyChunks(allocator);
+	CTAllocatorResetLiveStats(&allocator->stats);
+	for (CTAllocatorScope * scope = allocator->scope; scope; scope = scope->parent)
+	{
+		CTAllocatorFreeScope(allocator, scope, 0);
+	}
+	if (allocator->shared)
+	{
+		for (struct CTAllocatorCache * cache = allocator->shared->caches; cache; cache = cache->next)
+		{
+			for (CTAllocatorScope * scope = cache->scope; scope; scope = scope->parent)
+			{
+				CTAllocatorFreeScope(allocator, scope, 0);
+			}
+			memset(cache->counts, 0, sizeof(cache->counts));
+			CTAllocatorResetLiveStats(&cache->stats);
+		}
+	}
+	CTAllocatorUnlock(allocator);
 }
 
 void CTAllocatorRelease(CTAllocatorRef restrict allocator)
 {
 	CTAllocatorEmpty(allocator);
+	CTAllocatorFreeChunks(allocator, allocator->spare);
+	if (allocator->shared)
+	{
+		for (struct CTAllocatorCache * cache = allocator->shared->caches, * next; cache; cache = next)
+		{
+			next = cache->next;
+			free(cache);
+		}
+		pthread_mutex_destroy(&allocator->shared->lock);
+		free(allocator->shared);
+	}
 	free(allocator->objects);
 	free(allocator);
 }
 
-void * CTAllocatorAllocate(CTAllocatorRef restrict allocator, uint64_t size)
+/**
+ * Allocators handed to CTAllocatorReleaseDeferred, released in order by a single background thread that is started on first use.
+ **/
+struct CTAllocatorReclaimer
+{
+	pthread_mutex_t lock;
+	pthread_cond_t queued;
+	pthread_cond_t idle;
+	pthread_once_t once;
+	uint64_t pending;
+	struct CTAllocatorReclaimItem
+	{
+		struct CTAllocatorReclaimItem * next;
+		CTAllocatorRef allocator;
+	} * head, ** tail;
+};
+
+static struct CTAllocatorReclaimer CTAllocatorReclaimer =
+{
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_ONCE_INIT,
+	0,
+	NULL,
+	&CTAllocatorReclaimer.head
+};
+
+static void * CTAllocatorReclaimerMain(void * argument)
+{
+#ifdef SCHED_BATCH
+	// Batch scheduling keeps wakeups of the reclaimer from preempting the threads that queued the work
+	struct sched_param parameters = {0};
+	pthread_setschedparam(pthread_self(), SCHED_BATCH, &parameters);
+#endif
+	pthread_mutex_lock(&CTAllocatorReclaimer.lock);
+	while (1)
+	{
+		while (!CTAllocatorReclaimer.head)
+		{
+			pthread_cond_wait(&CTAllocatorReclaimer.queued, &CTAllocatorReclaimer.lock);
+		}
+		// Take the whole queue so that threads deferring more allocators never wait on a release in progress
+		struct CTAllocatorReclaimItem * item = CTAllocatorReclaimer.head;
+		CTAllocatorReclaimer.head = NULL;
+		CTAllocatorReclaimer.tail = &CTAllocatorReclaimer.head;
+		pthread_mutex_unlock(&CTAllocatorReclaimer.lock);
+		uint64_t released = 0;
+		for (struct CTAllocatorReclaimItem * next; item; item = next)
+		{
+			next = item->next;
+			CTAllocatorRelease(item->allocator);
+			free(item);
+			++released;
+		}
+		pthread_mutex_lock(&CTAllocatorReclaimer.lock);
+		CTAllocatorReclaimer.pending -= released;
+		if (!CTAllocatorReclaimer.pending)
+		{
+			pthread_cond_broadcast(&CTAllocatorReclaimer.idle);
+		}
+	}
+	return argument;
+}
+
+static void CTAllocatorReclaimerStart(void)
+{
+	pthread_t thread;
+	pthread_attr_t attributes;
+	pthread_attr_init(&attributes);
+	pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+	int result = pthread_create(&thread, &attributes, CTAllocatorReclaimerMain, NULL);
+	assert(!result);
+	pthread_attr_destroy(&attributes);
+}
+
+void CTAllocatorReleaseDeferred(CTAllocatorRef restrict allocator)
 {
 	assert(allocator);
+	struct CTAllocatorReclaimItem * item = malloc(sizeof(struct CTAllocatorReclaimItem));
+	assert(item);
+	item->next = NULL;
+	item->allocator = allocator;
+	pthread_once(&CTAllocatorReclaimer.once, CTAllocatorReclaimerStart);
+	pthread_mutex_lock(&CTAllocatorReclaimer.lock);
+	*CTAllocatorReclaimer.tail = item;
+	CTAllocatorReclaimer.tail = &item->next;
+	++CTAllocatorReclaimer.pending;
+	pthread_cond_signal(&CTAllocatorReclaimer.queued);
+	pthread_mutex_unlock(&CTAllocatorReclaimer.lock);
+}
+
+void CTAllocatorReclaimWait(void)
+{
+	pthread_mutex_lock(&CTAllocatorReclaimer.lock);
+	while (CTAllocatorReclaimer.pending)
+	{
+		pthread_cond_wait(&CTAllocatorReclaimer.idle, &CTAllocatorReclaimer.lock);
+	}
+	pthread_mutex_unlock(&CTAllocatorReclaimer.lock);
+}
+
+static void CTAllocatorTrackBlock(CTAllocatorRef restrict allocator, CTAllocatorBlock * block)
+{
+	CTAllocatorLock(allocator);
 	uint64_t index = allocator->count++;
 	if (index >= allocator->size)
 	{
 		allocator->size = kArrayGrowthFactor * allocator->count;
 		assert(allocator->objects = realloc(allocator->objects, sizeof(void *) * allocator->size));
 	}
-	return allocator->objects[index] = calloc(1, size);
+	block->index = index;
+	allocator->objects[index] = block;
+	CTAllocatorUnlock(allocator);
+}
+
+static void * CTAllocatorAllocateBlock(CTAllocatorRef restrict allocator, uint64_t size, uint64_t alignment, CTAllocatorOptions options)
+{
+	if (allocator->type == CTALLOCATOR_TYPE_ARENA)
+	{
+		return CTAllocatorArenaAllocate(allocator, size, alignment, options);
+	}
+	if (size <= kSmallBlockLimit && alignment == kMinimumAlignment)
+	{
+		return CTAllocatorSmallAllocate(allocator, size, options);
+	}
+
+	// malloc returns 16 byte aligned memory, so the header and padding never need more than alignment bytes
+	uint8_t mapped = CTAllocatorShouldMap(allocator, alignment + size);
+	char * base = mapped ? CTAllocatorMapPages(CTAllocatorPageAlign(alignment + size)) : CTAllocatorBackendAllocate(allocator, alignment + size, options);
+	char * ptr = CTAllocatorAlignPointer(base + sizeof(CTAllocatorBlock), alignment);
+	CTAllocatorBlock * block = (CTAllocatorBlock *)ptr - 1;
+	CTAllocatorBlockInitialise(block, CT_NOT_FOUND, size, alignment, ptr - base);
+	block->mapped = mapped;
+	CTAllocatorTrackBlock(allocator, block);
+	return ptr;
+}
+
+void * CTAllocatorAllocate(CTAllocatorRef restrict allocator, uint64_t size)
+{
+	return CTAllocatorAllocateAligned(allocator, size, 0, 0);
+}
+
+void * CTAllocatorAllocateAligned(CTAllocatorRef restrict allocator, uint64_t size, uint64_t alignment, CTAllocatorOptions options)
+{
+	assert(allocator);
+	CTAllocatorProfileSample(size);
+	alignment = CTAllocatorNormaliseAlignment(alignment);
+	CTAllocatorScope ** scope = CTAllocatorCurrentScope(allocator);
+	void * ptr = scope && *scope ? CTAllocatorScopedAllocate(allocator, *scope, size, alignment, options) : CTAllocatorAllocateBlock(allocator, size, alignment, options);
+	CTAllocatorRecordAllocation(allocator, size);
+	return ptr;
+}
+
+static CTAllocatorBlock * CTAllocatorUntrackBlock(CTAllocatorRef restrict allocator, void * ptr)
+{
+	CTAllocatorLock(allocator);
+	CTAllocatorBlock * block = CTAllocatorBlockForPointer(allocator, ptr);
+	if (block)
+	{
+		CTAllocatorBlock * last = allocator->objects[--allocator->count];
+		__atomic_store_n(&last->index, block->index, __ATOMIC_RELAXED);
+		allocator->objects[block->index] = last;
+	}
+	CTAllocatorUnlock(allocator);
+	return block;
 }
 
 void CTAllocatorDeallocate(CTAllocatorRef restrict allocator, void * ptr)
 {
 	assert(allocator);
-	if (allocator->count > 0)
+	if (ptr && CTAllocatorBlockIsInRegion((CTAllocatorBlock *)ptr - 1))
 	{
-		for (uint64_t i = 0; i < allocator->count; ++i)
+		// Regions are returned in one piece along with the block they were reserved from
+		return;
+	}
+	else if (ptr && CTAllocatorBlockIsScoped((CTAllocatorBlock *)ptr - 1))
+	{
+		CTAllocatorRecordDeallocation(allocator, ((CTAllocatorBlock *)ptr - 1)->size);
+		CTAllocatorScopedDeallocate(allocator, (CTAllocatorBlock *)ptr - 1);
+	}
+	else if (ptr && allocator->type != CTALLOCATOR_TYPE_ARENA)
+	{
+		if (CTAllocatorBlockIsSmall((CTAllocatorBlock *)ptr - 1))
 		{
-			if (allocator->objects[i] == ptr)
-			{
-				free(allocator->objects[i]);
-				memmove(allocator->objects + i, allocator->objects + i + 1, sizeof(void *) * (--allocator->count - i));
-				break;
-			}
+			CTAllocatorRecordDeallocation(allocator, ((CTAllocatorBlock *)ptr - 1)->size);
+			CTAllocatorSmallDeallocate(allocator, (CTAllocatorBlock *)ptr - 1);
+			return;
+		}
+		
+		CTAllocatorBlock * block = CTAllocatorUntrackBlock(allocator, ptr);
+		if (block)
+		{
+			CTAllocatorRecordDeallocation(allocator, block->size);
+			CTAllocatorFreeBlock(allocator, block);
+		}
+	}
+}
+
+static CTAllocatorBlock * CTAllocatorResizeBlock(CTAllocatorRef restrict allocator, CTAllocatorBlock * block, uint64_t size)
+{
+	uint64_t old_size = block->size;
+	uint64_t copy = sizeof(CTAllocatorBlock) + (old_size < size ? old_size : size);
+	uint64_t offset = block->offset * 0x10;
+	uint64_t alignment = CTAllocatorBlockAlignment(block);
+	uint8_t mapped = block->mapped || CTAllocatorShouldMap(allocator, alignment + size);
+	char * base = NULL;
+	if (block->mapped)
+	{
+		// Mappings are page aligned, so the block keeps its offset wherever the pages end up
+#ifdef MREMAP_MAYMOVE
+		base = mremap(CTAllocatorBlockBase(block), CTAllocatorBlockMappedLength(block), CTAllocatorPageAlign(alignment + size), MREMAP_MAYMOVE);
+		assert(base != MAP_FAILED);
+#else
+		base = CTAllocatorMapPages(CTAllocatorPageAlign(alignment + size));
+		memcpy(base + offset - sizeof(CTAllocatorBlock), block, copy);
+		CTAllocatorFreeBlock(allocator, block);
+#endif
+	}
+	else if (mapped)
+	{
+		base = CTAllocatorMapPages(CTAllocatorPageAlign(alignment + size));
+		offset = CTAllocatorAlignPointer(base + sizeof(CTAllocatorBlock), alignment) - base;
+		memcpy(base + offset - sizeof(CTAllocatorBlock), block, copy);
+		CTAllocatorFreeBlock(allocator, block);
+	}
+	else
+	{
+		base = CTAllocatorBackendReallocate(allocator, CTAllocatorBlockBase(block), alignment + old_size, alignment + size);
+		char * ptr = CTAllocatorAlignPointer(base + sizeof(CTAllocatorBlock), alignment);
+		if (ptr != base + offset)
+		{
+			// realloc only keeps 16 byte alignment, so the header and contents may need to slide to the new aligned position
+			memmove(ptr - sizeof(CTAllocatorBlock), base + offset - sizeof(CTAllocatorBlock), copy);
+			offset = ptr - base;
 		}
 	}
+	block = (CTAllocatorBlock *)(base + offset) - 1;
+	CTAllocatorBlockInitialise(block, block->index, size, alignment, offset);
+	block->mapped = mapped;
+	return block;
+}
+
+static void * CTAllocatorMoveBlock(CTAllocatorRef restrict allocator, void * ptr, uint64_t size, uint64_t alignment, CTAllocatorOptions options)
+{
+	CTAllocatorBlock * block = (CTAllocatorBlock *)ptr - 1;
+	uint8_t small = CTAllocatorBlockIsSmall(block);
+	if (!small && !CTAllocatorUntrackBlock(allocator, ptr))
+	{
+		return CTAllocatorAllocateAligned(allocator, size, alignment, options);
+	}
+	CTAllocatorRecordReallocation(allocator, block->size, size);
+	void * new_ptr = CTAllocatorAllocateBlock(allocator, size, alignment, options);
+	memcpy(new_ptr, ptr, block->size < size ? block->size : size);
+	if (small)
+	{
+		CTAllocatorSmallDeallocate(allocator, block);
+	}
+	else
+	{
+		CTAllocatorFreeBlock(allocator, block);
+	}
+	return new_ptr;
 }
 
 void * CTAllocatorReallocate(CTAllocatorRef restrict allocator, void * ptr, uint64_t size)
+{
+	return CTAllocatorReallocateAligned(allocator, ptr, size, 0, 0);
+}
+
+void * CTAllocatorReallocateAligned(CTAllocatorRef restrict allocator, void * ptr, uint64_t size, uint64_t alignment, CTAllocatorOptions options)
 {
 	assert(allocator);
+	alignment = CTAllocatorNormaliseAlignment(alignment);
 	if (ptr)
 	{
-		for (uint64_t i = 0; i < allocator->count; ++i)
+		CTAllocatorProfileSample(size);
+		CTAllocatorBlock * block = (CTAllocatorBlock *)ptr - 1;
+		if (CTAllocatorBlockIsInRegion(block))
+		{
+			if (size <= block->size && alignment <= CTAllocatorBlockAlignment(block))
+			{
+				block->size = size;
+				return ptr;
+			}
+			// Blocks leave their region when they grow, the space they used is only returned along with the region
+			void * new_ptr = CTAllocatorAllocateAligned(allocator, size, alignment > CTAllocatorBlockAlignment(block) ? alignment : CTAllocatorBlockAlignment(block), options);
+			memcpy(new_ptr, ptr, block->size < size ? block->size : size);
+			return new_ptr;
+		}
+		else if (CTAllocatorBlockIsScoped(block))
+		{
+			CTAllocatorRecordReallocation(allocator, block->size, size);
+			return CTAllocatorScopedReallocate(allocator, block, size, alignment);
+		}
+		else if (allocator->type == CTALLOCATOR_TYPE_ARENA)
+		{
+			if (block->index == kArenaIndex)
+			{
+				CTAllocatorRecordReallocation(allocator, block->size, size);
+				return CTAllocatorArenaReallocate(allocator, ptr, size, alignment, options);
+			}
+		}
+		else if (CTAllocatorBlockIsSmall(block))
+		{
+			if (size <= kSmallBlockLimit && alignment == kMinimumAlignment && CTAllocatorSizeClass(size) == CTAllocatorSizeClass(block->size))
+			{
+				CTAllocatorRecordReallocation(allocator, block->size, size);
+				block->size = size;
+				return ptr;
+			}
+			return CTAllocatorMoveBlock(allocator, ptr, size, alignment, options);
+		}
+		else if (alignment > CTAllocatorBlockAlignment(block))
+		{
+			return CTAllocatorMoveBlock(allocator, ptr, size, alignment, options);
+		}
+		else
+		{
+			// The lock is held across realloc because deallocating another block may rewrite this block's index
+			CTAllocatorLock(allocator);
+			block = CTAllocatorBlockForPointer(allocator, ptr);
+			if (block)
+			{
+				uint64_t old_size = block->size;
+				block = CTAllocatorResizeBlock(allocator, block, size);
+				allocator->objects[block->index] = block;
+				CTAllocatorUnlock(allocator);
+				CTAllocatorRecordReallocation(allocator, old_size, size);
+				return block + 1;
+			}
+			CTAllocatorUnlock(allocator);
+		}
+	}
+	return CTAllocatorAllocateAligned(allocator, size, alignment, options);
+}
+
+void * CTAllocatorTransfer(CTAllocatorRef restrict allocator, CTAllocatorRef restrict destination, void * ptr)
+{
+	assert(allocator && destination);
+	if (!ptr || allocator == destination)
+	{
+		return ptr;
+	}
+	CTAllocatorBlock * block = (CTAllocatorBlock *)ptr - 1;
+	uint64_t size = block->size;
+	// Individually allocated blocks can change hands as long as both allocators would free them the same way
+	if (destination->type != CTALLOCATOR_TYPE_ARENA && !memcmp(&allocator->backend, &destination->backend, sizeof(CTAllocatorBackend)))
+	{
+		uint64_t index = CTAllocatorBlockIndex(block);
+		if (index != CT_NOT_FOUND && index != kScopedIndex && index != kRegionIndex && index != kArenaIndex && CTAllocatorUntrackBlock(allocator, ptr))
+		{
+			CTAllocatorRecordDeallocation(allocator, size);
+			CTAllocatorTrackBlock(destination, block);
+			CTAllocatorRecordAllocation(destination, size);
+			return ptr;
+		}
+	}
+	// Everything else shares memory with other blocks of its allocator, so it is copied
+	void * new_ptr = CTAllocatorAllocateBlock(destination, size, CTAllocatorBlockAlignment(block), CTAllocatorOptionsUninitialised);
+	memcpy(new_ptr, ptr, size);
+	CTAllocatorRecordAllocation(destination, size);
+	CTAllocatorDeallocate(allocator, ptr);
+	return new_ptr;
+}
+
+uint64_t CTAllocatorTrim(CTAllocatorRef restrict allocator)
+{
+	assert(allocator);
+	uint64_t released = 0;
+	CTAllocatorLock(allocator);
+	for (struct CTAllocatorChunk * chunk = allocator->spare, * next; chunk; chunk = next)
+	{
+		next = chunk->next;
+		released += sizeof(struct CTAllocatorChunk) + chunk->size;
+		CTAllocatorFreeChunk(allocator, chunk);
+	}
+	allocator->spare = NULL;
+	CTAllocatorUnlock(allocator);
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+	return released;
+}
+
+void CTAllocatorMark(CTAllocatorRef restrict allocator, CTAllocatorScope * scope)
+{
+	assert(allocator && scope);
+	if (allocator->shared)
+	{
+		__atomic_add_fetch(&allocator->shared->scopes, 1, __ATOMIC_RELAXED);
+	}
+	CTAllocatorScope ** current = allocator->shared ? &CTAllocatorThreadCache(allocator)->scope : &allocator->scope;
+	scope->parent = *current;
+	scope->blocks.next = scope->blocks.prev = &scope->blocks;
+	*current = scope;
+}
+
+void CTAllocatorRewind(CTAllocatorRef restrict allocator, CTAllocatorScope * scope)
+{
+	assert(allocator && scope);
+	CTAllocatorScope ** current = allocator->shared ? &CTAllocatorThreadCache(allocator)->scope : &allocator->scope;
+	assert(*current == scope);
+	CTAllocatorLock(allocator);
+	CTAllocatorFreeScope(allocator, scope, 1);
+	CTAllocatorUnlock(allocator);
+	*current = scope->parent;
+	if (allocator->shared)
+	{
+		__atomic_sub_fetch(&allocator->shared->scopes, 1, __ATOMIC_RELAXED);
+	}
+}
+
+uint64_t CTAllocatorRegionBlockSize(uint64_t size, uint64_t alignment)
+{
+	return CTAllocatorNormaliseAlignment(alignment) - kMinimumAlignment + CTAllocatorAlign(sizeof(CTAllocatorBlock) + size);
+}
+
+uint64_t CTAllocatorBlockSize(const void * ptr)
+{
+	const CTAllocatorBlock * block = (const CTAllocatorBlock *)ptr - 1;
+	const uint64_t index = CTAllocatorBlockIndex(block);
+	if (block->mapped)
+	{
+		return CTAllocatorBlockMappedLength(block);
+	}
+	if (index == CT_NOT_FOUND || index == kArenaIndex || index == kRegionIndex)
+	{
+		// Chunks and regions pack blocks back to back, small blocks are rounded up to their size class, which is the same 16 bytes
+		return CTAllocatorAlign(sizeof(CTAllocatorBlock) + block->size);
+	}
+	return CTAllocatorBlockAlignment(block) + block->size + (index == kScopedIndex ? sizeof(CTAllocatorLink) : 0);
+}
+
+void CTAllocatorReserve(CTAllocatorRef restrict allocator, CTAllocatorRegion * region, uint64_t size)
+{
+	assert(allocator && region);
+	region->next = CTAllocatorAllocateAligned(allocator, size, 0, CTAllocatorOptionsUninitialised);
+	region->end = region->next + size;
+}
+
+void * CTAllocatorAllocateFromRegion(CTAllocatorRef restrict allocator, CTAllocatorRegion * region, uint64_t size, uint64_t alignment)
+{
+	assert(allocator && region);
+	alignment = CTAllocatorNormaliseAlignment(alignment);
+	char * ptr = CTAllocatorAlignPointer(region->next + sizeof(CTAllocatorBlock), alignment);
+	if (ptr + size > region->end)
+	{
+		return CTAllocatorAllocateAligned(allocator, size, alignment, CTAllocatorOptionsUninitialised);
+	}
+	// The offset is never used, region blocks are not passed to free or realloc on their own
+	CTAllocatorBlockInitialise((CTAllocatorBlock *)ptr - 1, kRegionIndex, size, alignment, 0);
+	region->next = ptr + CTAllocatorAlign(size);
+	return ptr;
+}
+
+CTAllocatorStats CTAllocatorGetStats(CTAllocatorRef restrict allocator)
+{
+	assert(allocator);
+	CTAllocatorLock(allocator);
+	if (allocator->shared)
+	{
+		CTAllocatorSamplePeak(allocator);
+	}
+	CTAllocatorStats stats = allocator->stats;
+	if (allocator->shared)
+	{
+		// Every field is a counter, and the caches never record a peak of their own
+		for (struct CTAllocatorCache * cache = allocator->shared->caches; cache; cache = cache->next)
+		{
+			const uint64_t * source = (const uint64_t *)&cache->stats;
+			uint64_t * destination = (uint64_t *)&stats;
+			for (uint64_t i = 0; i < sizeof(CTAllocatorStats) / sizeof(uint64_t); ++i)
+			{
+				destination[i] += __atomic_load_n(&source[i], __ATOMIC_RELAXED);
+			}
+		}
+	}
+	CTAllocatorUnlock(allocator);
+	return stats;
+}
+
+void CTAllocatorCountObject(CTAllocatorRef restrict allocator, int type, int64_t delta)
+{
+	assert(allocator);
+	uint64_t index = type + 1;
+	if (index < CTALLOCATOR_OBJECT_TYPES)
+	{
+		CTAllocatorStats * stats = CTAllocatorThreadStats(allocator);
+		CTAllocatorStatsAdd(stats->objects[index], delta);
+	}
+}
+
+#ifdef CTALLOCATOR_PROFILE
+void CTAllocatorProfileStart(uint64_t rate)
+{
+	__atomic_store_n(&CTAllocatorProfileRate, rate, __ATOMIC_RELAXED);
+}
+
+void CTAllocatorProfileWrite(FILE * file, CTALLOCATOR_PROFILE_FORMAT format)
+{
+	pthread_mutex_lock(&CTAllocatorProfileLock);
+	struct CTAllocatorProfileStack * stacks = malloc(sizeof(CTAllocatorProfileStacks));
+	assert(stacks);
+	uint64_t count = 0;
+	for (uint64_t i = 0; i < CTALLOCATOR_PROFILE_STACKS; ++i)
+	{
+		if (CTAllocatorProfileStacks[i].hash)
+		{
+			stacks[count++] = CTAllocatorProfileStacks[i];
+		}
+	}
+	uint64_t dropped = CTAllocatorProfileDropped;
+	pthread_mutex_unlock(&CTAllocatorProfileLock);
+	qsort(stacks, count, sizeof(struct CTAllocatorProfileStack), CTAllocatorProfileCompare);
+	
+	char buffer[0x20];
+	if (format == CTALLOCATOR_PROFILE_FORMAT_REPORT)
+	{
+		fprintf(file, "%-14s %-12s %s\n", "bytes", "calls", "stack");
+	}
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		struct CTAllocatorProfileStack * stack = &stacks[i];
+		uint64_t first = CTAllocatorProfileFirstFrame(stack);
+		if (format == CTALLOCATOR_PROFILE_FORMAT_COLLAPSED)
+		{
+			for (uint64_t j = stack->depth; j-- > first;)
+			{
+				fprintf(file, j > first ? "%s;" : "%s", CTAllocatorProfileSymbol(stack->frames[j], buffer, sizeof(buffer)));
+			}
+			fprintf(file, " %llu\n", (unsigned long long)stack->bytes);
+		}
+		else
 		{
-			if (allocator->objects[i] == ptr)
+			fprintf(file, "%-14llu %-12llu", (unsigned long long)stack->bytes, (unsigned long long)stack->samples);
+			for (uint64_t j = first; j < stack->depth; ++j)
 			{
-				return allocator->objects[i] = realloc(ptr, size);
+				fprintf(file, j > first ? " < %s" : " %s", CTAllocatorProfileSymbol(stack->frames[j], buffer, sizeof(buffer)));
 			}
+			fprintf(file, "\n");
 		}
 	}
-	return CTAllocatorAllocate(allocator, size);
-}
\ No newline at end of file
+	if (dropped && format == CTALLOCATOR_PROFILE_FORMAT_REPORT)
+	{
+		fprintf(file, "%llu samples were dropped because the profile was full\n", (unsigned long long)dropped);
+	}
+	free(stacks);
+}
+
+void CTAllocatorProfileReset(void)
+{
+	pthread_mutex_lock(&CTAllocatorProfileLock);
+	memset(CTAllocatorProfileStacks, 0, sizeof(CTAllocatorProfileStacks));
+	CTAllocatorProfileDropped = 0;
+	pthread_mutex_unlock(&CTAllocatorProfileLock);
+}
+#else
+void CTAllocatorProfileStart(uint64_t rate)
+{
+	(void)rate;
+}
+
+void CTAllocatorProfileWrite(FILE * file, CTALLOCATOR_PROFILE_FORMAT format)
+{
+	(void)file;
+	(void)format;
+}
+
+void CTAllocatorProfileReset(void)
+{
+}
+#endif
\ No newline at end of file
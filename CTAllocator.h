@@ -8,15 +8,110 @@
 
 #pragma once
 #include "CTDefine.h"
+#include <stdio.h>
+
+/**
+ * Blocks of up to CTALLOCATOR_SIZE_CLASSES * 16 bytes are carved out of shared chunks and recycled through per-size-class free lists rather than being allocated individually.
+ **/
+#define CTALLOCATOR_SIZE_CLASSES 8
+
+/**
+ * The alignment used by the string, array and data modules for buffers too large to be small blocks, so that vectorised code can use aligned loads on them.
+ **/
+#define CTALLOCATOR_SIMD_ALIGNMENT 32
+
+#define CTALLOCATOR_HISTOGRAM_BUCKETS 16
+#define CTALLOCATOR_OBJECT_TYPES 8
+
+/**
+ * Statistics kept by every CTAllocator, see CTAllocatorGetStats.
+ * histogram counts live blocks by size, bucket 0 holds blocks of up to 16 bytes and every following bucket doubles that, the last bucket holds everything larger.
+ * objects counts live CTObjects by type and is indexed by CTOBJECT_TYPE + 1, so that CTOBJECT_NOT_AN_OBJECT is at index 0.
+ **/
+typedef struct
+{
+	uint64_t live_blocks;
+	uint64_t live_bytes;
+	uint64_t peak_bytes;
+	uint64_t allocations;
+	uint64_t reallocations;
+	uint64_t deallocations;
+	uint64_t histogram[CTALLOCATOR_HISTOGRAM_BUCKETS];
+	uint64_t objects[CTALLOCATOR_OBJECT_TYPES];
+} CTAllocatorStats;
+
+enum CTALLOCATOR_OPTIONS
+{
+	CTAllocatorOptionsUninitialised = (1UL << 0)
+};
+
+typedef uint64_t CTAllocatorOptions;
+
+typedef enum
+{
+	CTALLOCATOR_PROFILE_FORMAT_REPORT,
+	CTALLOCATOR_PROFILE_FORMAT_COLLAPSED
+} CTALLOCATOR_PROFILE_FORMAT;
+
+typedef enum
+{
+	CTALLOCATOR_TYPE_DEFAULT,
+	CTALLOCATOR_TYPE_ARENA
+} CTALLOCATOR_TYPE;
+
+struct CTAllocatorChunk;
+struct CTAllocatorShared;
+
+/**
+ * The functions a CTAllocator gets its memory from, see CTAllocatorCreateWithBackend. Memory returned by allocate and reallocate must be aligned to at least 16 bytes and does not need to be zeroed. The sizes passed to reallocate and deallocate are the sizes the memory was last allocated or reallocated with.
+ * context is passed to every call and is never touched by the allocator.
+ **/
+typedef struct
+{
+	void * (*allocate)(void * context, uint64_t size);
+	void * (*reallocate)(void * context, void * ptr, uint64_t old_size, uint64_t size);
+	void (*deallocate)(void * context, void * ptr, uint64_t size);
+	void * context;
+} CTAllocatorBackend;
+
+/**
+ * A savepoint on a CTAllocator, see CTAllocatorMark. Scopes are owned by the caller, usually on the stack, and must stay put until they are rewound.
+ **/
+typedef struct CTAllocatorScope
+{
+	struct CTAllocatorScope * parent;
+	struct CTAllocatorScopeLink
+	{
+		struct CTAllocatorScopeLink * next;
+		struct CTAllocatorScopeLink * prev;
+	} blocks;
+} CTAllocatorScope;
+
+/**
+ * A single block that other blocks are carved out of back to back, see CTAllocatorReserve. Regions are owned by the caller and only needed while blocks are being carved out of them.
+ **/
+typedef struct
+{
+	char * next;
+	char * end;
+} CTAllocatorRegion;
 
 /**
  * An object that acts as a front to malloc, realloc and free in order to keep track of allocated memory.
  **/
 typedef struct
 {
+	CTALLOCATOR_TYPE type;
 	uint64_t count;
 	uint64_t size;
 	void ** objects;
+	struct CTAllocatorChunk * chunks;
+	struct CTAllocatorChunk * spare;
+	void * free_blocks[CTALLOCATOR_SIZE_CLASSES];
+	struct CTAllocatorShared * shared;
+	CTAllocatorScope * scope;
+	CTAllocatorBackend backend;
+	CTAllocatorStats stats;
 } CTAllocator, * CTAllocatorRef;
 
 /**
@@ -25,6 +120,26 @@ typedef struct
  **/
 CTAllocatorRef CTAllocatorCreate(void);
 
+/**
+ * Create a CTAllocator that gets the memory for its blocks and chunks from a custom backend instead of malloc, realloc, free and mmap. The allocator's own bookkeeping still uses malloc.
+ * @param backend	The backend to use, which is copied. All three functions must be set.
+ * @return			Returns an initialised CTAllocator that behaves like one created with CTAllocatorCreate.
+ **/
+CTAllocatorRef CTAllocatorCreateWithBackend(const CTAllocatorBackend * backend);
+
+/**
+ * Create a CTAllocator that hands out memory from large contiguous chunks with a bump pointer. Deallocating an individual block is a no-op, all memory is returned at once by CTAllocatorEmpty or CTAllocatorRelease.
+ * @return	Returns an initialised CTAllocator that can be used anywhere a CTAllocator created with CTAllocatorCreate can.
+ **/
+CTAllocatorRef CTAllocatorCreateArena(void);
+
+/**
+ * Create a CTAllocator that can be used to allocate, reallocate and deallocate from several threads at once. Each thread keeps a cache of free small blocks and only takes the allocator's lock to refill or drain it.
+ * CTAllocatorEmpty and CTAllocatorRelease must not be called while other threads are still using the allocator.
+ * @return	Returns an initialised, thread-safe CTAllocator.
+ **/
+CTAllocatorRef CTAllocatorCreateShared(void);
+
 /**
  * Deallocate all memory allocations associated with a specified CTAllocator, including that used by the allocator itself.
  * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate.
@@ -32,7 +147,18 @@ CTAllocatorRef CTAllocatorCreate(void);
 void CTAllocatorRelease(CTAllocatorRef restrict allocator);
 
 /**
- * Deallocate all memory allocations associated with a specified CTAllocator, excluding that used by the allocator itself.
+ * Hand a CTAllocator to a background thread that releases it as CTAllocatorRelease would, so that freeing a large document costs the caller a single queue insertion. The allocator must not be used again by the caller, and a custom backend must stay valid and accept calls from the background thread until the allocator is released.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*, which no other thread is still using.
+ **/
+void CTAllocatorReleaseDeferred(CTAllocatorRef restrict allocator);
+
+/**
+ * Block until every allocator handed to CTAllocatorReleaseDeferred so far has been released, such as before a custom backend is torn down or the process measures its memory use.
+ **/
+void CTAllocatorReclaimWait(void);
+
+/**
+ * Deallocate all memory allocations associated with a specified CTAllocator, excluding that used by the allocator itself. Chunks used for small blocks are kept and reused by later allocations.
  * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate.
  **/
 void CTAllocatorEmpty(CTAllocatorRef restrict allocator);
@@ -43,6 +169,16 @@ void CTAllocatorEmpty(CTAllocatorRef restrict allocator);
  **/
 void * CTAllocatorAllocate(CTAllocatorRef restrict allocator, uint64_t size);
 
+/**
+ * Allocate memory with a given alignment, optionally without zeroing it.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param size		The size of the block.
+ * @param alignment	A power of two of at most 4096 that the returned pointer is a multiple of, or 0 for the default of 16. Blocks keep their alignment when reallocated.
+ * @param options	CTAllocatorOptionsUninitialised to leave the contents of the block undefined instead of zeroing it.
+ * @return			Returns a block of memory that is released along with the allocator.
+ **/
+void * CTAllocatorAllocateAligned(CTAllocatorRef restrict allocator, uint64_t size, uint64_t alignment, CTAllocatorOptions options);
+
 /**
  * Reallocate memory to be the specified size if a pointer to it exists in the object's array.
  * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate.
@@ -52,10 +188,118 @@ void * CTAllocatorAllocate(CTAllocatorRef restrict allocator, uint64_t size);
  **/
 void * CTAllocatorReallocate(CTAllocatorRef restrict allocator, void * ptr, uint64_t size);
 
+/**
+ * Reallocate memory to be the specified size, moving it if it is not already aligned to at least the given alignment. Memory past the block's previous size is never zeroed.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param ptr		A pointer to the chunk of memory to resize, or NULL to allocate a new one.
+ * @param size		The size to reallocate the block as.
+ * @param alignment	A power of two of at most 4096, or 0 for the default of 16.
+ * @param options	Options used when a new block is allocated, see CTAllocatorAllocateAligned.
+ * @return			Returns the resized block of memory.
+ **/
+void * CTAllocatorReallocateAligned(CTAllocatorRef restrict allocator, void * ptr, uint64_t size, uint64_t alignment, CTAllocatorOptions options);
+
 /**
  * Deallocate memory at the given address and remove it from the object's array.
  * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate.
  * @param ptr		A pointer to the chunk of memory to deallocate.
  * @return			A dark void, filled with eldritch creatures, the sight of which would cause any human to lose all connections to reality.
  **/
-void CTAllocatorDeallocate(CTAllocatorRef restrict allocator, void * ptr);
\ No newline at end of file
+void CTAllocatorDeallocate(CTAllocatorRef restrict allocator, void * ptr);
+
+/**
+ * Hand a block over from one allocator to another, so that it is deallocated along with the destination instead. Individually allocated blocks are moved without copying when both allocators get their memory from the same backend. Blocks that share memory with other blocks, such as small, arena, scoped and region blocks, are copied into the destination and deallocated from the source. Transferred blocks never belong to a scope of the destination.
+ * @param allocator		The CTAllocator the block was allocated with.
+ * @param destination	The CTAllocator to hand the block over to.
+ * @param ptr			The block to transfer, or NULL.
+ * @return				Returns the block's address in the destination, which is ptr unless the block had to be copied.
+ **/
+void * CTAllocatorTransfer(CTAllocatorRef restrict allocator, CTAllocatorRef restrict destination, void * ptr);
+
+/**
+ * Return memory that an allocator is holding on to without using it to the operating system, such as the chunks CTAllocatorEmpty keeps for reuse. Blocks of 256KB or more are always mapped individually and given back as soon as they are deallocated.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @return			The number of bytes of chunks released by the allocator.
+ **/
+uint64_t CTAllocatorTrim(CTAllocatorRef restrict allocator);
+
+/**
+ * Start a scope on an allocator. Every block allocated from it by this thread until the scope is rewound belongs to the scope, including blocks allocated by other functions on its behalf. Blocks allocated before the mark can still be reallocated and deallocated normally and are never affected by the rewind.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param scope		The scope to start, which must outlive the call to CTAllocatorRewind.
+ **/
+void CTAllocatorMark(CTAllocatorRef restrict allocator, CTAllocatorScope * scope);
+
+/**
+ * Deallocate every block allocated within a scope that has not already been deallocated, and end the scope. Scopes nest and must be rewound in the reverse order they were marked.
+ * @param allocator	The CTAllocator the scope was marked on.
+ * @param scope		The innermost scope of the calling thread.
+ **/
+void CTAllocatorRewind(CTAllocatorRef restrict allocator, CTAllocatorScope * scope);
+
+/**
+ * Return the space a block takes up in a CTAllocatorRegion, including its header and the worst case padding for its alignment, so that a region can be reserved with room for a known set of blocks.
+ * @param size		The size of the block.
+ * @param alignment	The alignment the block will be requested with.
+ * @return			The number of bytes of the region the block can use up.
+ **/
+uint64_t CTAllocatorRegionBlockSize(uint64_t size, uint64_t alignment);
+
+/**
+ * Return the memory a block takes up, including its header, the rounding of its size and any padding for its alignment, so that the footprint of a set of blocks can be told exactly, see CTObjectGetFootprint.
+ * @param ptr	A block allocated with a CTAllocator.
+ * @return		The number of bytes the block keeps from being used for anything else.
+ **/
+uint64_t CTAllocatorBlockSize(const void * ptr);
+
+/**
+ * Reserve a region of contiguous memory on an allocator. The region is a single block to the allocator, it is counted once in the statistics and is returned in one piece when the allocator is emptied or released, or when the scope it was reserved in is rewound.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param region	The region to initialise.
+ * @param size		The size of the region, usually the sum of CTAllocatorRegionBlockSize for every block it will hold.
+ **/
+void CTAllocatorReserve(CTAllocatorRef restrict allocator, CTAllocatorRegion * region, uint64_t size);
+
+/**
+ * Carve an uninitialised block out of a region, directly after the previous one. The block can be used like any other block of the allocator: deallocating it does nothing and reallocating it to a larger size moves it out of the region, its space in the region is only returned along with the region.
+ * @param allocator	The CTAllocator the region was reserved on.
+ * @param region	The region to carve the block out of. When it is full the block is allocated from the allocator as usual.
+ * @param size		The size of the block.
+ * @param alignment	A power of two of at most 4096, or 0 for the default of 16.
+ * @return			Returns an uninitialised block of memory.
+ **/
+void * CTAllocatorAllocateFromRegion(CTAllocatorRef restrict allocator, CTAllocatorRegion * region, uint64_t size, uint64_t alignment);
+
+/**
+ * Return a snapshot of the statistics kept by a CTAllocator. Live counts cover blocks that have not been deallocated; arena allocators only release blocks when emptied. For allocators created with CTAllocatorCreateShared the peak is sampled whenever a thread refills or drains its cache.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @return			The allocator's statistics.
+ **/
+CTAllocatorStats CTAllocatorGetStats(CTAllocatorRef restrict allocator);
+
+/**
+ * Attribute the creation or release of a CTObject to a CTAllocator's statistics. This is called by CTObjectCreate and CTObjectRelease.
+ * @param allocator	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param type		The CTOBJECT_TYPE of the object.
+ * @param delta		1 when the object is created, -1 when it is released.
+ **/
+void CTAllocatorCountObject(CTAllocatorRef restrict allocator, int type, int64_t delta);
+
+
+/**
+ * Start sampling calls to CTAllocatorAllocate* and CTAllocatorReallocate* from every thread and allocator. The profiler is only compiled in when CTALLOCATOR_PROFILE is defined, otherwise this does nothing.
+ * @param rate	Record the call stack of one in every rate calls per thread, counts and bytes in the profile are scaled back up by the rate. 0 stops sampling.
+ **/
+void CTAllocatorProfileStart(uint64_t rate);
+
+/**
+ * Write the samples collected since CTAllocatorProfileStart. Frames are symbolised with dladdr, so executables should be linked with -rdynamic, unresolved frames are written as addresses.
+ * @param file		The file to write to.
+ * @param format	CTALLOCATOR_PROFILE_FORMAT_REPORT writes call stacks sorted by bytes allocated, one line per stack with its estimated bytes, calls and frames. CTALLOCATOR_PROFILE_FORMAT_COLLAPSED writes one root-first, semicolon-separated stack per line followed by its estimated bytes, as read by flamegraph.pl and pprof.
+ **/
+void CTAllocatorProfileWrite(FILE * file, CTALLOCATOR_PROFILE_FORMAT format);
+
+/**
+ * Discard the samples collected so far without changing the sampling rate.
+ **/
+void CTAllocatorProfileReset(void);
\ No newline at end of file
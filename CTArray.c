@@ -13,6 +13,7 @@
 #include <stdarg.h>
 #include <math.h>
 #include "CTArray.h"
+#include "CTFunctions.h"
 
 CTArrayRef CTArrayCreate(CTAllocatorRef restrict alloc)
 {
@@ -45,6 +46,10 @@ CTArrayRef CTArrayCopy(CTAllocatorRef alloc, const CTArray * restrict array)
 
 void CTArrayRelease(CTArrayRef restrict array)
 {
+	if (referencesRelease(&array->references))
+	{
+		return;
+	}
 	CTArrayEach(array, ^(CTObject *object) {
 		CTObjectRelease(object);
 	});
@@ -54,13 +59,30 @@ void CTArrayRelease(CTArrayRef restrict array)
 
 uint8_t CTArrayCompare(const CTArray * array1, const CTArray * array2)
 {
-	return array1->count == array2->count
-	&&
-	CTArrayAll(array1, ^uint8_t(const CTObject * object1) {
-		return CTArrayAny(array2, ^uint8_t(const CTObject * object2) {
-			return CTObjectCompare(object1, object2);
-		});
-	});
+	// Compared as objects, so that nested dictionaries and arrays are compared without recursing
+	const CTObject object1 = {.alloc = array1->alloc, .ptr = (void *)array1, .type = CTOBJECT_TYPE_ARRAY};
+	const CTObject object2 = {.alloc = array2->alloc, .ptr = (void *)array2, .type = CTOBJECT_TYPE_ARRAY};
+	return CTObjectCompare(&object1, &object2);
+}
+
+uint64_t CTArrayHash(const CTArray * restrict array)
+{
+	if (hashMemoized(array->hash_pass, &array->references))
+	{
+		return array->hash;
+	}
+	const uint64_t previous = hashPassEnter();
+	// Adding the elements' hashes makes the hash independent of their order, like CTArrayCompare
+	uint64_t hash = CTOBJECT_TYPE_ARRAY + array->count;
+	for (uint64_t i = 0; i < array->count; ++i)
+	{
+		hash += hashMix(CTObjectHash(array->elements[i]));
+	}
+	CTArrayRef memo = (CTArrayRef)array;
+	memo->hash = hashMix(hash);
+	memo->hash_pass = hashPass();
+	hashPassLeave(previous);
+	return memo->hash;
 }
 
 void CTArrayAddEntry(CTArrayRef restrict array, void * value, int8_t type)
@@ -70,12 +92,13 @@ void CTArrayAddEntry(CTArrayRef restrict array, void * value, int8_t type)
 
 void CTArrayAddEntry2(CTArrayRef restrict array, CTObjectRef restrict value)
 {
-	assert(value);
+	assert(value && !array->references);
+	array->hash_pass = 0;
     uint64_t index = array->count++;
 	if (index >= array->size)
 	{
 		array->size = kArrayGrowthFactor * array->count;
-		assert(array->elements = CTAllocatorReallocate(array->alloc, array->elements, sizeof(CTArray *) * array->size));
+		assert(array->elements = bufferReallocate(array->alloc, array->elements, sizeof(CTArray *) * array->size));
 	}
     array->elements[index] = value;
 }
@@ -89,7 +112,8 @@ CTObjectRef CTArrayEntry(const CTArray * restrict array, uint64_t index)
 
 void CTArrayDeleteEntry(CTArrayRef restrict array, uint64_t index)
 {
-	assert(array->count > index);
+	assert(array->count > index && !array->references);
+	array->hash_pass = 0;
 	CTObjectRelease(array->elements[index]);
 	memmove(array->elements + index, array->elements + index + 1, sizeof(CTObject **) * (--array->count - index));
 }
@@ -122,6 +146,8 @@ uint64_t CTArrayIndexOfEntryByValue(const CTArray * restrict array, CTObjectRef
 
 void CTArrayEmpty(CTArrayRef restrict array)
 {
+	assert(!array->references);
+	array->hash_pass = 0;
 	if (array->count)
 	{
 		CTArrayEach(array, ^(CTObject *object) {
@@ -147,6 +173,8 @@ inline uint64_t CTArrayCount(const CTArray * restrict array)
 
 void CTArrayMapMutate(CTArrayRef restrict array, void (^mapFn)(const CTObject * object))
 {
+	assert(!array->references);
+	array->hash_pass = 0;
 	for (uint64_t i = 0; i < array->count; ++i)
 	{
 		mapFn(array->elements[i]);
@@ -283,7 +311,7 @@ CTNumber * CTArrayMin(CTNumber * container, const CTArray * array)
 	for (uint64_t i = 0; i < array->count; ++i)
 	{
 		assert(CTObjectType(array->elements[i]) == CTOBJECT_TYPE_NUMBER);
-		const CTNumber * number = CTObjectValue(array->elements[i]);
+		const CTNumber * number = array->elements[i]->ptr;
 		if (CTNumberDoubleValue(number) < CTNumberDoubleValue(container))
 		{
 			CTNumberSetDoubleValue(container, CTNumberDoubleValue(number));
@@ -297,7 +325,7 @@ CTNumber * CTArrayMax(CTNumber * container, const CTArray * array)
 	for (uint64_t i = 0; i < array->count; ++i)
 	{
 		assert(CTObjectType(array->elements[i]) == CTOBJECT_TYPE_NUMBER);
-		const CTNumber * number = CTObjectValue(array->elements[i]);
+		const CTNumber * number = array->elements[i]->ptr;
 		if (CTNumberDoubleValue(number) > CTNumberDoubleValue(container))
 		{
 			CTNumberSetDoubleValue(container, CTNumberDoubleValue(number));
@@ -311,7 +339,7 @@ CTNumber * CTArrayAverage(CTNumber * container, const CTArray * array)
 	for (uint64_t i = 0; i < array->count; ++i)
 	{
 		assert(CTObjectType(array->elements[i]) == CTOBJECT_TYPE_NUMBER);
-		const CTNumber * number = CTObjectValue(array->elements[i]);
+		const CTNumber * number = array->elements[i]->ptr;
 		CTNumberSetDoubleValue(container, CTNumberDoubleValue(container) + CTNumberDoubleValue(number) / array->count);
 	}
 	return container;
@@ -13,7 +13,7 @@
 #include "CTError.h"
 
 /**
- * An object that keeps an array of type independent, dynamically allocated elements.
+ * An object that keeps an array of type independent, dynamically allocated elements. references counts the objects sharing the array besides its owner, see CTObjectCopy, and hash is memoized in the hashing pass hash_pass, see CTObjectHash.
  **/
 typedef struct
 {
@@ -21,6 +21,9 @@ typedef struct
     uint64_t count;
 	uint64_t size;
     CTObjectRef* elements;
+	uint64_t references;
+	uint64_t hash;
+	uint64_t hash_pass;
 } CTArray, * CTArrayRef;
 
 /**
@@ -52,12 +55,19 @@ CTArrayRef CTArrayCreateWithObjects(CTAllocatorRef restrict alloc, ...);
 void CTArrayRelease(CTArrayRef restrict array);
 
 /**
- * Compare two CTArray objects
+ * Compare two CTArray objects. Arrays are equal when they hold equal elements regardless of their order, counting repeated elements, so [1, 1, 2] and [1, 2, 2] are not equal even though each element has an equal one in the other array, which used to be enough. Arrays with different hashes are told apart without comparing their elements.
  * @param array	A properly initialised CTArray that was created with CTArrayCreate*.
  * @return		A value indicating equality, 0 = false, 1 = true.
  **/
 uint8_t CTArrayCompare(const CTArray * array1, const CTArray * array2);
 
+/**
+ * Return the structural hash of an array, which is independent of the order of its elements, see CTObjectHash.
+ * @param array	A properly initialised CTArray that was created with CTArrayCreate*.
+ * @return		The hash of the array.
+ **/
+uint64_t CTArrayHash(const CTArray * restrict array);
+
 /**
  * Add a CTObject to the end of the array.
  * @param array	A properly initialised CTArray that was created with CTArrayCreate*.
@@ -8,87 +8,54 @@
 
 #include "CTBencode.h"
 #include "CTNumber.h"
+#include "CTString.h"
+#include "CTFunctions.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
-#include <math.h>
 
-CTStringRef CTBencodeExtractString(CTAllocatorRef alloc, CTStringRef bencodedString, uint64_t * start)
+#define CTBENCODE_PARSE_INLINE_FRAMES 0x20
+
+typedef struct
+{
+	CTObjectRef container;
+	CTStringRef key;
+} CTBencodeParseFrame;
+
+static inline char CTBencodeCharacter(const char * restrict bencoded, uint64_t length, uint64_t start)
 {
-    CTStringRef retVal = CTStringCreate(alloc, "");
-    uint64_t length = strtoull(CTStringUTF8String(bencodedString) + *start, NULL, 10);
-	
-	*start += length > 0 ? ceil(log10(length + 1)) + 1 : 2;
-    if (*start + length <= CTStringLength(bencodedString))
-    {
-        CTStringAppendCharacters(retVal, CTStringUTF8String(bencodedString) + *start, length);
-    }
-    *start += length;
-    return retVal;
+	return start < length ? bencoded[start] : 0;
 }
 
-CTDictionaryRef CTBencodeExtractDictionary(CTAllocatorRef alloc, CTStringRef bencodedString, uint64_t * start, CTErrorRef * error)
+static uint8_t CTBencodeFail(CTAllocatorRef alloc, CTErrorRef * error, const char * restrict message)
 {
-    ++(*start);
-    CTDictionaryRef dict = CTDictionaryCreate(alloc);
-    while (*start < CTStringLength(bencodedString) && CTStringUTF8String(bencodedString)[*start] != 'e' && !*error)
-    {
-        CTStringRef key = CTObjectValue(CTBencodeParse2(alloc, CTStringUTF8String(bencodedString), start, error));
-        CTObjectRef value = CTBencodeParse2(alloc, CTStringUTF8String(bencodedString), start, error);
-        
-        if (key && value)
-        {
-            CTDictionaryAddEntry2(dict, key, value);
-        }
-        else
-        {
-			if (error)
-			{
-				*error = CTErrorCreate(alloc, "Mismatched count of keys and values", 0);
-			}
-        }
-    }
-    if(CTStringUTF8String(bencodedString)[*start] != 'e')
-    {
-		if (error)
-		{
-			*error = CTErrorCreate(alloc, "No terminating e found for dictionary", 0);
-		}
-    }
-    ++(*start);
-    return dict;
+	if (error)
+	{
+		*error = CTErrorCreate(alloc, message, 0);
+	}
+	return 1;
 }
 
-CTArrayRef CTBencodeExtractList(CTAllocatorRef alloc, CTStringRef bencodedString, uint64_t * start, CTErrorRef * error)
+static const char * CTBencodeExtractString(const char * restrict bencoded, uint64_t length, uint64_t * start, uint64_t * string_length)
 {
-    ++(*start);
-    CTArrayRef list = CTArrayCreate(alloc);
-    while (*start < CTStringLength(bencodedString) && CTStringUTF8String(bencodedString)[*start] != 'e' && !*error)
-    {
-        CTArrayAddEntry2(list, CTBencodeParse2(alloc, CTStringUTF8String(bencodedString), start, error));
-    }
-    if (CTStringUTF8String(bencodedString)[*start] != 'e')
-    {
-        *error = CTErrorCreate(alloc, "No terminating e found for list", 0);
-    }
-    ++(*start);
-    return list;
+	char * end = NULL;
+	uint64_t size = strtoull(bencoded + *start, &end, 10);
+	// The length is followed by a colon, strings that run past the end of the data are left empty
+	*start = (uint64_t)(end - bencoded) < length ? end - bencoded + 1 : length;
+	const char * characters = bencoded + *start;
+	*string_length = *start + size <= length ? size : 0;
+	*start = *start + size <= length ? *start + size : length;
+	return characters;
 }
 
-CTNumberRef CTBencodeExtractInteger(CTAllocatorRef alloc, CTStringRef bencodedString, uint64_t * start)
+static int64_t CTBencodeExtractInteger(const char * restrict bencoded, uint64_t length, uint64_t * start)
 {
-    ++(*start);
-    CTStringRef string = CTStringCreate(alloc, "");
-    
-    while ((CTStringUTF8String(bencodedString)[*start] >= '0' && CTStringUTF8String(bencodedString)[*start] <= '9' ) || CTStringUTF8String(bencodedString)[*start] == '.' || CTStringUTF8String(bencodedString)[*start] == '-' || CTStringUTF8String(bencodedString)[*start] == '+')
-    {
-        CTStringAppendCharacter(string, CTStringUTF8String(bencodedString)[*start]);
-        ++(*start);
-    }
-    ++(*start);
-    int64_t value = strtoll(CTStringUTF8String(string), NULL, 10);
-    return CTNumberCreateWithLong(alloc, value);
+	++(*start);
+	int64_t value = strtoll(bencoded + *start, NULL, 10);
+	for (char character = CTBencodeCharacter(bencoded, length, *start); (character >= '0' && character <= '9') || character == '.' || character == '-' || character == '+'; character = CTBencodeCharacter(bencoded, length, ++(*start)));
+	++(*start);
+	return value;
 }
 
 CTObjectRef CTBencodeParse(CTAllocatorRef alloc, const char * bencoded, CTErrorRef * error)
@@ -99,130 +66,182 @@ CTObjectRef CTBencodeParse(CTAllocatorRef alloc, const char * bencoded, CTErrorR
 
 CTObjectRef CTBencodeParse2(CTAllocatorRef alloc, const char * bencoded, uint64_t * start, CTErrorRef * error)
 {
-	CTObjectRef retVal = NULL;
-    CTAllocatorRef lalloc = CTAllocatorCreate();
-    CTStringRef bencodedString = CTStringCreate(lalloc, bencoded);
-    
-    if (CTStringLength(bencodedString))
-    {
-        if (*start < CTStringLength(bencodedString))
-        {
-            switch (bencoded[*start])
-            {
-                case 'd':
-                    retVal = CTObjectCreate(alloc, CTBencodeExtractDictionary(alloc, bencodedString, start, error), CTOBJECT_TYPE_DICTIONARY);
-                    break;
-                case 'l':
-                    retVal = CTObjectCreate(alloc, CTBencodeExtractList(alloc, bencodedString, start, error), CTOBJECT_TYPE_ARRAY);
-                    break;
-                case 'i':
-                    retVal = CTObjectCreate(alloc, CTBencodeExtractInteger(alloc, bencodedString, start), CTOBJECT_TYPE_NUMBER);
-                    break;
-                case '-':
-                case '0':
-                case '1':
-                case '2':
-                case '3':
-                case '4':
-                case '5':
-                case '6':
-                case '7':
-                case '8':
-                case '9':
-                    retVal = CTObjectCreate(alloc, CTBencodeExtractString(alloc, bencodedString, start), CTOBJECT_TYPE_STRING);
-                    break;
-                default:
-                    *error = CTErrorCreate(alloc, "Incorrect starting character", 0);
-                    break;
-            }
-        }
-    }
-    else
-    {
-        *error = CTErrorCreate(alloc, "Empty string", 0);
-    }
-    
-    CTAllocatorRelease(lalloc);
-    return retVal;
+	// Nested dictionaries and lists are kept on a stack of their own rather than the C stack, so the depth of the data is only limited by memory
+	CTBencodeParseFrame inline_frames[CTBENCODE_PARSE_INLINE_FRAMES];
+	CTBencodeParseFrame * frames = inline_frames;
+	uint64_t capacity = CTBENCODE_PARSE_INLINE_FRAMES, depth = 0;
+	const uint64_t length = strlen(bencoded);
+	uint8_t failed = length ? 0 : CTBencodeFail(alloc, error, "Empty string");
+	CTObjectRef value = NULL;
+	while (!failed || depth)
+	{
+		CTBencodeParseFrame * frame = depth ? &frames[depth - 1] : NULL;
+		if (frame && (failed || *start >= length || bencoded[*start] == 'e'))
+		{
+			// The innermost dictionary or list ends here, it is then handed to its parent like any other value
+			uint8_t isDictionary = frame->container->type == CTOBJECT_TYPE_DICTIONARY;
+			if (frame->key)
+			{
+				failed = failed || CTBencodeFail(alloc, error, "Mismatched count of keys and values");
+				CTStringRelease(frame->key);
+				frame->key = NULL;
+			}
+			if (CTBencodeCharacter(bencoded, length, *start) != 'e' && !failed)
+			{
+				failed = CTBencodeFail(alloc, error, isDictionary ? "No terminating e found for dictionary" : "No terminating e found for list");
+			}
+			++(*start);
+			value = frame->container;
+			--depth;
+		}
+		else if (frame && frame->container->type == CTOBJECT_TYPE_DICTIONARY && !frame->key)
+		{
+			char character = bencoded[*start];
+			if ((character >= '0' && character <= '9') || character == '-')
+			{
+				uint64_t key_length = 0;
+				const char * key = CTBencodeExtractString(bencoded, length, start, &key_length);
+				frame->key = CTStringCreate(alloc, "");
+				CTStringAppendCharacters(frame->key, key, key_length);
+			}
+			else
+			{
+				failed = CTBencodeFail(alloc, error, "Dictionary keys must be strings");
+			}
+			continue;
+		}
+		else if (*start >= length)
+		{
+			value = NULL;
+		}
+		else
+		{
+			switch (bencoded[*start])
+			{
+				case 'd':
+				case 'l':
+				{
+					if (depth == capacity)
+					{
+						frames = stackGrow(frames, inline_frames, &capacity, sizeof(CTBencodeParseFrame));
+					}
+					CTObjectRef container = bencoded[*start] == 'd' ? CTObjectWithDictionary(alloc, CTDictionaryCreate(alloc)) : CTObjectWithArray(alloc, CTArrayCreate(alloc));
+					frames[depth++] = (CTBencodeParseFrame){container, NULL};
+					++(*start);
+					continue;
+				}
+				case 'i':
+					value = CTObjectWithLong(alloc, CTBencodeExtractInteger(bencoded, length, start));
+					break;
+				case '-':
+				case '0':
+				case '1':
+				case '2':
+				case '3':
+				case '4':
+				case '5':
+				case '6':
+				case '7':
+				case '8':
+				case '9':
+				{
+					uint64_t string_length = 0;
+					const char * characters = CTBencodeExtractString(bencoded, length, start, &string_length);
+					value = CTObjectWithCharacters(alloc, characters, string_length);
+					break;
+				}
+				default:
+					failed = CTBencodeFail(alloc, error, "Incorrect starting character");
+					value = NULL;
+					break;
+			}
+		}
+		if (!depth)
+		{
+			break;
+		}
+		frame = &frames[depth - 1];
+		if (!value)
+		{
+			continue;
+		}
+		if (frame->container->type == CTOBJECT_TYPE_DICTIONARY)
+		{
+			CTDictionaryAddEntry2(frame->container->ptr, frame->key, value);
+			frame->key = NULL;
+		}
+		else
+		{
+			CTArrayAddEntry2(frame->container->ptr, value);
+		}
+	}
+	stackRelease(frames, inline_frames);
+	return value;
 }
 
-CTStringRef CTBencodeSerialise(CTAllocatorRef restrict alloc, CTObjectRef restrict bencoded, CTErrorRef * error)
+static void CTBencodeSerialiseLength(CTStringRef bencoded, uint64_t length)
+{
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%llu:", (unsigned long long)length);
+	CTStringAppendCharacters(bencoded, buf, CTSTRING_NO_LIMIT);
+}
+
+static void CTBencodeSerialiseKey(CTStringRef bencoded, const CTObject * parent, uint64_t index)
 {
-    CTStringRef retVal = CTStringCreate(alloc, "");
-    CTAllocatorRef allocl = CTAllocatorCreate();
-    switch (CTObjectType(bencoded))
-    {
-        case CTOBJECT_TYPE_DICTIONARY:
-        {
-            CTStringAppendCharacter(retVal, 'd');
-            for (uint64_t i = 0; i < CTDictionaryCount(CTObjectValue(bencoded)); ++i)
-            {
-				CTDictionaryEntry * pair = CTDictionaryEntryAtIndex(CTObjectValue(bencoded), i);
-                if (CTStringLength(CTObjectValue(bencoded)))
-                {
-                    char buf[(int)ceil(log10(CTStringLength(CTDictionaryEntryKey(pair))) + 1)];
-                    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)CTStringLength(CTDictionaryEntryKey(pair)));
-                    CTStringAppendCharacters(retVal, buf, CTSTRING_NO_LIMIT);
-                    CTStringAppendCharacter(retVal, ':');
-                    CTStringAppendString(retVal, CTDictionaryEntryKey(pair));
-                }
-                else
-                {
-                    CTStringAppendCharacters(retVal, "0:", CTSTRING_NO_LIMIT);
-                }
-                CTStringAppendString(retVal, CTBencodeSerialise(allocl, CTDictionaryEntryValue(pair), error));
-            }
-            CTStringAppendCharacter(retVal, 'e');
-            break;
-        }
-            
-        case CTOBJECT_TYPE_ARRAY:
-        {
-            CTStringAppendCharacter(retVal, 'l');
-            for (uint64_t i = 0; i < ((CTArrayRef)CTObjectValue(bencoded))->count; ++i)
-            {
-                CTStringAppendString(retVal, CTBencodeSerialise(allocl, CTArrayObjectAtIndex(CTObjectValue(bencoded), i), error));
-            }
-            CTStringAppendCharacter(retVal, 'e');
-            break;
-        }
-            
-        case CTOBJECT_TYPE_NUMBER:
-        {
-            CTStringAppendCharacter(retVal, 'i');
-            if (CTNumberUnsignedLongValue(CTObjectValue(bencoded)))
-            {
-                char buf[(int)ceil(log10(CTNumberUnsignedLongValue(CTObjectValue(bencoded))) + 1)];
-                snprintf(buf, sizeof(buf), "%llu", (unsigned long long)CTNumberUnsignedLongValue(CTObjectValue(bencoded)));
-                CTStringAppendCharacters(retVal, buf, CTSTRING_NO_LIMIT);
-            }
-            else
-            {
-                CTStringAppendCharacter(retVal, '0');
-            }
-            CTStringAppendCharacter(retVal, 'e');
-            break;
-        }
-            
-        case CTOBJECT_TYPE_STRING:
-        {
-            if (CTStringLength(CTObjectValue(bencoded)))
-            {
-                char buf[(unsigned)ceil(log10(CTStringLength(CTObjectValue(bencoded))) + 1)];
-                snprintf(buf, sizeof(buf), "%llu", (unsigned long long)CTStringLength(CTObjectValue(bencoded)));
-                CTStringAppendCharacters(retVal, buf, CTSTRING_NO_LIMIT);
-            }
-            else
-            {
-                CTStringAppendCharacter(retVal, '0');
-            }
-            CTStringAppendCharacter(retVal, ':');
-            CTStringAppendString(retVal, CTObjectValue(bencoded));
-            break;
-        }
+	if (parent && parent->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		CTStringRef key = CTDictionaryEntryKey(CTDictionaryEntryAtIndex(parent->ptr, index));
+		CTBencodeSerialiseLength(bencoded, CTStringLength(key));
+		CTStringAppendString(bencoded, key);
+	}
+}
+
+static uint8_t CTBencodeSerialiseEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTStringRef bencoded = walker->context;
+	CTBencodeSerialiseKey(bencoded, parent, index);
+	CTStringAppendCharacter(bencoded, object->type == CTOBJECT_TYPE_DICTIONARY ? 'd' : 'l');
+	return 1;
+}
+
+static void CTBencodeSerialiseLeave(CTObjectWalker * walker, const CTObject * object)
+{
+	CTStringAppendCharacter(walker->context, 'e');
+}
+
+static void CTBencodeSerialiseScalar(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTStringRef bencoded = walker->context;
+	CTBencodeSerialiseKey(bencoded, parent, index);
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_NUMBER:
+		{
+			char buf[24];
+			if (CTNumberType(object->ptr) == CTNUMBER_TYPE_ULONG)
+			{
+				snprintf(buf, sizeof(buf), "i%llue", (unsigned long long)CTNumberUnsignedLongValue(object->ptr));
+			}
+			else
+			{
+				snprintf(buf, sizeof(buf), "i%llie", (long long)CTNumberLongValue(object->ptr));
+			}
+			CTStringAppendCharacters(bencoded, buf, CTSTRING_NO_LIMIT);
+			break;
+		}
+		case CTOBJECT_TYPE_STRING:
+			CTBencodeSerialiseLength(bencoded, CTStringLength(object->ptr));
+			CTStringAppendString(bencoded, object->ptr);
+			break;
 		default:
 			break;
-    }
-	CTAllocatorRelease(allocl);
-    return retVal;
+	}
+}
+
+CTStringRef CTBencodeSerialise(CTAllocatorRef restrict alloc, CTObjectRef restrict bencoded, CTErrorRef * error)
+{
+	CTStringRef retVal = CTStringCreate(alloc, "");
+	CTObjectWalker walker = {CTBencodeSerialiseEnter, CTBencodeSerialiseLeave, CTBencodeSerialiseScalar, retVal, NULL};
+	CTObjectWalk(bencoded, &walker);
+	return retVal;
 }
\ No newline at end of file
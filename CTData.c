@@ -7,12 +7,13 @@
 //
 
 #include "CTData.h"
+#include "CTFunctions.h"
 #include <string.h>
 
 CTDataRef CTDataCreate(CTAllocatorRef restrict alloc, const void * restrict bytes, uint64_t length)
 {
     CTDataRef data = CTAllocatorAllocate(alloc, sizeof(CTData));
-    void * copy = CTAllocatorAllocate(alloc, length);
+    void * copy = bufferAllocate(alloc, length);
     memcpy(copy, bytes, length);
     data->bytes = copy;
     data->length = length;
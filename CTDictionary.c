@@ -89,15 +89,36 @@ CTDictionaryRef CTDictionaryCreateWithKeysPairedWithStrings(CTAllocatorRef restr
 CTDictionaryRef CTDictionaryCopy(CTAllocatorRef restrict alloc, CTDictionaryRef dict)
 {
 	CTDictionaryRef new_dict = CTDictionaryCreate(alloc);
-	for (uint64_t i = 0; i < dict->count; ++i)
+	if (dict->count)
 	{
-		CTDictionaryAddEntry(new_dict, dict->elements[i]->key->characters, CTObjectCopy(alloc, dict->elements[i]->value));
+		new_dict->count = dict->count;
+		new_dict->elements = CTAllocatorAllocate(alloc, sizeof(CTDictionaryEntry *) * dict->count);
+		for (uint64_t i = 0; i < dict->count; ++i)
+		{
+			CTStringRef key = dict->elements[i]->key;
+			if (key->alloc == alloc)
+			{
+				// Keys are never modified in place, so they can be shared like values
+				referencesRetain(&key->references);
+			}
+			else
+			{
+				key = CTStringCopy(alloc, key);
+			}
+			new_dict->elements[i] = CTDictionaryCreateEntry(alloc);
+			new_dict->elements[i]->key = key;
+			new_dict->elements[i]->value = CTObjectCopy(alloc, dict->elements[i]->value);
+		}
 	}
 	return new_dict;
 }
 
 void CTDictionaryRelease(CTDictionaryRef dict)
 {
+	if (referencesRelease(&dict->references))
+	{
+		return;
+	}
 	for (uint64_t i = 0; i < dict->count; ++i)
     {
         CTStringRelease(dict->elements[i]->key);
@@ -108,29 +129,36 @@ void CTDictionaryRelease(CTDictionaryRef dict)
 	CTAllocatorDeallocate(dict->alloc, dict);
 }
 
+static uint64_t CTDictionaryEntryHash(const CTDictionaryEntry * restrict entry)
+{
+	return hashMix(CTStringHash(entry->key) + hashMix(CTObjectHash(entry->value)));
+}
+
 uint8_t CTDictionaryCompare(CTDictionaryRef dict1, CTDictionaryRef dict2)
 {
-	if (dict1->count == dict2->count)
+	// Compared as objects, so that nested dictionaries and arrays are compared without recursing
+	const CTObject object1 = {.alloc = dict1->alloc, .ptr = dict1, .type = CTOBJECT_TYPE_DICTIONARY};
+	const CTObject object2 = {.alloc = dict2->alloc, .ptr = dict2, .type = CTOBJECT_TYPE_DICTIONARY};
+	return CTObjectCompare(&object1, &object2);
+}
+
+uint64_t CTDictionaryHash(const CTDictionary * restrict dict)
+{
+	if (hashMemoized(dict->hash_pass, &dict->references))
 	{
-		for (uint64_t i = 0; i < dict1->count; ++i)
-		{
-			CTDictionaryEntry * entry1 = CTDictionaryEntryAtIndex(dict1, i);
-			CTDictionaryEntry * entry2 = NULL;
-			for (uint64_t j = 0; j < dict2->count; ++j)
-			{
-				CTDictionaryEntry * entryTemp = CTDictionaryEntryAtIndex(dict2, j);
-				if (CTStringCompare(entry1->key, entryTemp->key) == 0 && CTObjectCompare(entry1->value, entryTemp->value))
-				{
-					entry2 = entryTemp;
-					break;
-				}
-			}
-			
-			if (!entry2) return 0;
-		}
-		return 1;
+		return dict->hash;
+	}
+	const uint64_t previous = hashPassEnter();
+	uint64_t hash = CTOBJECT_TYPE_DICTIONARY + dict->count;
+	for (uint64_t i = 0; i < dict->count; ++i)
+	{
+		hash += CTDictionaryEntryHash(dict->elements[i]);
 	}
-	return 0;
+	CTDictionaryRef memo = (CTDictionaryRef)dict;
+	memo->hash = hashMix(hash);
+	memo->hash_pass = hashPass();
+	hashPassLeave(previous);
+	return memo->hash;
 }
 
 void CTDictionaryAddEntriesFromQueryString(CTDictionaryRef restrict dict, const char * restrict query)
@@ -166,6 +194,8 @@ void CTDictionaryAddEntry(CTDictionaryRef restrict dict, const char * restrict k
 
 void CTDictionaryAddEntry2(CTDictionaryRef restrict dict, CTStringRef restrict key, CTObjectRef restrict value)
 {
+	assert(!dict->references);
+	dict->hash_pass = 0;
     uint64_t index = dict->count++;
 	assert((dict->elements = CTAllocatorReallocate(dict->alloc, dict->elements, sizeof(CTDictionaryEntry *) * dict->count)));
     dict->elements[index] = CTDictionaryCreateEntry(dict->alloc);
@@ -175,6 +205,8 @@ void CTDictionaryAddEntry2(CTDictionaryRef restrict dict, CTStringRef restrict k
 
 void CTDictionaryDeleteEntry(CTDictionaryRef restrict dict, const char * restrict key)
 {
+	assert(!dict->references);
+	dict->hash_pass = 0;
     if (dict->count)
 	{
 		int countOfKeys = 0;
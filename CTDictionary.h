@@ -22,6 +22,9 @@ typedef struct
     CTAllocatorRef alloc;
     uint64_t count;
     CTDictionaryEntry ** elements;
+	uint64_t references;
+	uint64_t hash;
+	uint64_t hash_pass;
 } CTDictionary, * CTDictionaryRef;
 
 CTDictionaryRef CTDictionaryCreate(CTAllocatorRef restrict alloc);
@@ -37,6 +40,12 @@ void CTDictionaryRelease(CTDictionaryRef dict);
  * @return		A value indicating equality, 0 = false, 1 = true.
  **/
 uint8_t CTDictionaryCompare(CTDictionaryRef dict1, CTDictionaryRef dict2);
+/**
+ * Return the structural hash of a dictionary, which is independent of the order of its entries, see CTObjectHash.
+ * @param dict	A properly initialised CTDictionary that was created with CTDictionaryCreate*.
+ * @return		The hash of the dictionary.
+ **/
+uint64_t CTDictionaryHash(const CTDictionary * restrict dict);
 
 CTDictionaryEntry * CTDictionaryEntryAtIndex(const CTDictionary * restrict dict, uint64_t index);
 
@@ -8,12 +8,232 @@
 
 #include "CTFunctions.h"
 #include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+static const uint64_t kBufferAlignmentThreshold = 0x100;
+
+static inline uint64_t bufferAlignment(uint64_t size)
+{
+	return size >= kBufferAlignmentThreshold ? CTALLOCATOR_SIMD_ALIGNMENT : 0;
+}
 
 char * stringDuplicate(CTAllocatorRef restrict alloc, const char * restrict str)
 {
-    char * string;
-    string = CTAllocatorAllocate(alloc, strlen(str) + 1);
-    strcpy(string, str);
-    string[strlen(str)] = 0;
+    uint64_t length = strlen(str);
+    char * string = bufferAllocate(alloc, length + 1);
+    memcpy(string, str, length + 1);
     return string;
+}
+
+void * bufferAllocate(CTAllocatorRef restrict alloc, uint64_t size)
+{
+	return CTAllocatorAllocateAligned(alloc, size, bufferAlignment(size), CTAllocatorOptionsUninitialised);
+}
+
+void * bufferReallocate(CTAllocatorRef restrict alloc, void * ptr, uint64_t size)
+{
+	return CTAllocatorReallocateAligned(alloc, ptr, size, bufferAlignment(size), CTAllocatorOptionsUninitialised);
+}
+
+uint64_t bufferRegionSize(uint64_t size)
+{
+	return CTAllocatorRegionBlockSize(size, bufferAlignment(size));
+}
+
+void * bufferAllocateFromRegion(CTAllocatorRef restrict alloc, CTAllocatorRegion * region, uint64_t size)
+{
+	return CTAllocatorAllocateFromRegion(alloc, region, size, bufferAlignment(size));
+}
+
+void referencesRetain(uint64_t * references)
+{
+	if (referencesFrozen(references))
+	{
+		__atomic_add_fetch(references, 1, __ATOMIC_RELAXED);
+	}
+	else
+	{
+		++*references;
+	}
+}
+
+uint8_t referencesRelease(uint64_t * references)
+{
+	uint64_t count = __atomic_load_n(references, __ATOMIC_ACQUIRE);
+	if (count & kReferencesFrozen)
+	{
+		if (count == kReferencesFrozen || __atomic_fetch_sub(references, 1, __ATOMIC_ACQ_REL) == kReferencesFrozen)
+		{
+			// The last reference is gone, so no other thread can see the count any more
+			*references = kReferencesFrozen;
+			return 0;
+		}
+		return 1;
+	}
+	if (count)
+	{
+		--*references;
+		return 1;
+	}
+	return 0;
+}
+
+uint8_t referencesFrozen(const uint64_t * references)
+{
+	return (__atomic_load_n(references, __ATOMIC_RELAXED) & kReferencesFrozen) != 0;
+}
+
+void referencesFreeze(uint64_t * references)
+{
+	if (!referencesFrozen(references))
+	{
+		__atomic_or_fetch(references, kReferencesFrozen, __ATOMIC_RELEASE);
+	}
+}
+
+static uint64_t hashPasses = 0;
+static __thread uint64_t hashPassCurrent = 0;
+
+uint64_t hashPassEnter(void)
+{
+	const uint64_t previous = hashPassCurrent;
+	if (!previous)
+	{
+		// Passes are numbered across threads, so a memo left by another thread's pass is never mistaken for one of ours
+		hashPassCurrent = __atomic_add_fetch(&hashPasses, 1, __ATOMIC_RELAXED);
+	}
+	return previous;
+}
+
+void hashPassLeave(uint64_t previous)
+{
+	hashPassCurrent = previous;
+}
+
+uint64_t hashPass(void)
+{
+	return hashPassCurrent;
+}
+
+uint8_t hashMemoized(uint64_t pass, const uint64_t * references)
+{
+	return pass && (pass == hashPassCurrent || referencesFrozen(references));
+}
+
+uint64_t hashMix(uint64_t hash)
+{
+	hash ^= hash >> 30;
+	hash *= 0xBF58476D1CE4E5B9ULL;
+	hash ^= hash >> 27;
+	hash *= 0x94D049BB133111EBULL;
+	return hash ^ (hash >> 31);
+}
+
+uint64_t hashBytes(const void * restrict bytes, uint64_t length)
+{
+	// Words are read with memcpy, so the bytes need no particular alignment
+	const char * characters = bytes;
+	uint64_t hash = hashMix(length), word;
+	for (; length >= sizeof(word); length -= sizeof(word), characters += sizeof(word))
+	{
+		memcpy(&word, characters, sizeof(word));
+		hash = hashMix(hash + word);
+	}
+	word = 0;
+	memcpy(&word, characters, length);
+	return hashMix(hash + word);
+}
+
+typedef struct
+{
+	uint64_t hash;
+	uint64_t index;
+} hashMatchEntry;
+
+#define HASH_MATCH_INLINE_ENTRIES 0x40
+
+static int hashMatchEntryCompare(const void * entry1, const void * entry2)
+{
+	uint64_t hash1 = ((const hashMatchEntry *)entry1)->hash, hash2 = ((const hashMatchEntry *)entry2)->hash;
+	return hash1 < hash2 ? -1 : hash1 > hash2;
+}
+
+uint8_t hashMatch(uint64_t count, uint64_t (^hashFn)(uint8_t second, uint64_t index), uint8_t (^equalFn)(uint64_t index1, uint64_t index2, uint8_t only))
+{
+	if (count == 1)
+	{
+		// A single pair needs no scratch space, which keeps long chains of nested single element collections cheap
+		return hashFn(0, 0) == hashFn(1, 0) && equalFn(0, 0, 1);
+	}
+	// Scratch space comes from the C stack, or from malloc for larger collections, never from allocators that other threads may be using
+	hashMatchEntry inline_entries[HASH_MATCH_INLINE_ENTRIES];
+	uint8_t inline_used[HASH_MATCH_INLINE_ENTRIES] = {0};
+	hashMatchEntry * entries = count > HASH_MATCH_INLINE_ENTRIES ? malloc(sizeof(hashMatchEntry) * count) : inline_entries;
+	uint8_t * used = count > HASH_MATCH_INLINE_ENTRIES ? calloc(count, 1) : inline_used;
+	assert(entries && used);
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		entries[i].hash = hashFn(1, i);
+		entries[i].index = i;
+	}
+	qsort(entries, count, sizeof(hashMatchEntry), hashMatchEntryCompare);
+	uint8_t matched = 1;
+	for (uint64_t i = 0; i < count && matched; ++i)
+	{
+		uint64_t hash = hashFn(0, i), low = 0, high = count;
+		while (low < high)
+		{
+			uint64_t middle = low + (high - low) / 2;
+			if (entries[middle].hash < hash)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+		matched = 0;
+		uint64_t unused = 0;
+		for (uint64_t j = low; j < count && entries[j].hash == hash && unused < 2; ++j)
+		{
+			unused += !used[j];
+		}
+		for (uint64_t j = low; j < count && entries[j].hash == hash; ++j)
+		{
+			if (!used[j] && equalFn(i, entries[j].index, unused == 1))
+			{
+				used[j] = 1;
+				matched = 1;
+				break;
+			}
+		}
+	}
+	if (entries != inline_entries)
+	{
+		free(entries);
+		free(used);
+	}
+	return matched;
+}
+
+void * stackGrow(void * stack, const void * inline_stack, uint64_t * capacity, uint64_t size)
+{
+	void * grown = stack == inline_stack ? malloc(*capacity * 2 * size) : realloc(stack, *capacity * 2 * size);
+	assert(grown);
+	if (stack == inline_stack)
+	{
+		memcpy(grown, inline_stack, *capacity * size);
+	}
+	*capacity *= 2;
+	return grown;
+}
+
+void stackRelease(void * stack, const void * inline_stack)
+{
+	if (stack != inline_stack)
+	{
+		free(stack);
+	}
 }
\ No newline at end of file
@@ -10,4 +10,135 @@
 #include "CTAllocator.h"
 #include "CTString.h"
 
-char * stringDuplicate(CTAllocatorRef restrict alloc, const char * restrict str);
\ No newline at end of file
+char * stringDuplicate(CTAllocatorRef restrict alloc, const char * restrict str);
+
+/**
+ * Allocate a buffer that the caller is about to fill. The buffer is not zeroed, and buffers larger than a few cache lines are aligned to CTALLOCATOR_SIMD_ALIGNMENT.
+ * @param alloc	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param size	The size of the buffer.
+ * @return		Returns an uninitialised buffer.
+ **/
+void * bufferAllocate(CTAllocatorRef restrict alloc, uint64_t size);
+
+/**
+ * Resize a buffer allocated with bufferAllocate or CTAllocatorAllocate, aligning it to CTALLOCATOR_SIMD_ALIGNMENT once it grows large enough.
+ * @param alloc	The CTAllocator the buffer was allocated with.
+ * @param ptr	The buffer to resize, or NULL to allocate a new one.
+ * @param size	The new size of the buffer.
+ * @return		Returns the resized buffer, the contents past the previous size are undefined.
+ **/
+void * bufferReallocate(CTAllocatorRef restrict alloc, void * ptr, uint64_t size);
+
+/**
+ * Return the space bufferAllocateFromRegion needs in a region for a buffer, see CTAllocatorRegionBlockSize.
+ * @param size	The size of the buffer.
+ * @return		The number of bytes of the region the buffer can use up.
+ **/
+uint64_t bufferRegionSize(uint64_t size);
+
+/**
+ * Carve a buffer out of a region with the same alignment bufferAllocate would give it.
+ * @param alloc		The CTAllocator the region was reserved on.
+ * @param region	The region to carve the buffer out of.
+ * @param size		The size of the buffer.
+ * @return			Returns an uninitialised buffer.
+ **/
+void * bufferAllocateFromRegion(CTAllocatorRef restrict alloc, CTAllocatorRegion * region, uint64_t size);
+
+/**
+ * Set in the reference count of a value that CTObjectFreeze has made immutable, references to frozen values are counted atomically so they can be taken and dropped from any thread.
+ **/
+#define kReferencesFrozen 0x8000000000000000ULL
+
+/**
+ * Take a reference to a value shared between several owners.
+ * @param references	The reference count of the value.
+ **/
+void referencesRetain(uint64_t * references);
+
+/**
+ * Drop a reference to a value shared between several owners.
+ * @param references	The reference count of the value.
+ * @return				Returns 1 if the value is still referenced elsewhere, or 0 if the caller held the last reference and must free the value.
+ **/
+uint8_t referencesRelease(uint64_t * references);
+
+/**
+ * Mark a value as frozen. The bit is set atomically, as a value shared between trees may be frozen already and counted from other threads.
+ * @param references	The reference count of the value.
+ **/
+void referencesFreeze(uint64_t * references);
+
+/**
+ * Check whether a reference count belongs to a value frozen with CTObjectFreeze.
+ * @param references	The reference count of the value.
+ * @return				A value indicating whether the value is frozen, 0 = false, 1 = true.
+ **/
+uint8_t referencesFrozen(const uint64_t * references);
+
+/**
+ * Scramble a hash so that every bit of the input affects every bit of the output, before hashes are combined by addition.
+ * @param hash	The hash to scramble.
+ * @return		The scrambled hash.
+ **/
+uint64_t hashMix(uint64_t hash);
+
+/**
+ * Start a hashing pass on the calling thread, unless one is under way already. Dictionaries and arrays that are not frozen only trust the hashes memoized during the current pass, since they can be modified through a value fetched earlier without their parents noticing.
+ * @return		The pass that was under way, to be handed to hashPassLeave.
+ **/
+uint64_t hashPassEnter(void);
+
+/**
+ * Finish a hashing pass started with hashPassEnter.
+ * @param previous	The value hashPassEnter returned.
+ **/
+void hashPassLeave(uint64_t previous);
+
+/**
+ * The hashing pass the calling thread is in, which is 0 outside of one and is what dictionaries and arrays store their memoized hashes under.
+ * @return		The current pass.
+ **/
+uint64_t hashPass(void);
+
+/**
+ * Check whether the memoized hash of a dictionary or array can be trusted, which it can for good once the container is frozen, or otherwise only during the pass it was memoized in.
+ * @param pass			The pass the hash was memoized in, or 0 if it was not.
+ * @param references	The reference count of the container.
+ * @return				A value indicating whether the hash is current, 0 = false, 1 = true.
+ **/
+uint8_t hashMemoized(uint64_t pass, const uint64_t * references);
+
+/**
+ * Hash a run of bytes eight at a time, for keying caches by the contents of a buffer.
+ * @param bytes		The bytes to hash.
+ * @param length	The number of bytes.
+ * @return			The hash of the bytes.
+ **/
+uint64_t hashBytes(const void * restrict bytes, uint64_t length);
+
+/**
+ * Check whether two collections hold equal elements regardless of their order, counting repeated elements. Elements of the second collection are sorted by hash, so each element of the first is only compared with those of the same hash.
+ * @param count		The number of elements in each collection.
+ * @param hashFn	Returns the hash of an element of the first collection when second is 0, or of the second collection when second is 1. Equal elements must have equal hashes.
+ * @param equalFn	Compare an element of the first collection with an element of the second. only is 1 when the element of the second is the only unmatched one with that hash, in which case equalFn may settle part of the comparison later, as no other pairing could succeed in its place. Otherwise the elements are paired for good as soon as equalFn returns 1, so it must compare them fully.
+ * @return			A value indicating equality, 0 = false, 1 = true.
+ **/
+uint8_t hashMatch(uint64_t count, uint64_t (^hashFn)(uint8_t second, uint64_t index), uint8_t (^equalFn)(uint64_t index1, uint64_t index2, uint8_t only));
+
+/**
+ * Double the capacity of a stack used by an iterative traversal. Stacks start out in a buffer on the C stack and are moved to the heap once they outgrow it, so that deep trees cost heap memory rather than C stack.
+ * @param stack			The stack to grow.
+ * @param inline_stack	The buffer the stack started out in.
+ * @param capacity		The number of entries the stack can hold, which is updated.
+ * @param size			The size of an entry.
+ * @return				Returns the grown stack.
+ **/
+void * stackGrow(void * stack, const void * inline_stack, uint64_t * capacity, uint64_t size);
+
+/**
+ * Free a stack grown with stackGrow.
+ * @param stack			The stack to free.
+ * @param inline_stack	The buffer the stack started out in, which is left alone.
+ **/
+void stackRelease(void * stack, const void * inline_stack);
\ No newline at end of file
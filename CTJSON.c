@@ -15,6 +15,7 @@
 #include "CTNumber.h"
 #include "CTNull.h"
 #include <assert.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -23,27 +24,41 @@
 
 CTObjectRef CTStringFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error);
 CTObjectRef CTObjectFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error);
-void CTJSONSerialiseRecursive(CTAllocatorRef alloc, CTStringRef JSON, void * obj, CTOBJECT_TYPE type, CTJSONOptions options);
 CTObjectRef CTJSONParse2(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error);
-CTObjectRef CTDictionaryFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error);
 CTObjectRef CTLiteralFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTErrorRef * error);
 CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTErrorRef * error);
-CTObjectRef CTArrayFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error);
 
 
 CTObjectRef CTJSONParse(CTAllocatorRef restrict alloc, const char * restrict JSON, CTJSONOptions options, CTErrorRef * error)
 {
 	uint64_t start = 0;
-	CTAllocatorRef lalloc = CTAllocatorCreate();
+	CTAllocatorRef lalloc = CTAllocatorCreateArena();
 	CTStringRef JSONString = CTStringCreate(lalloc, JSON);
 	CTObjectRef retVal = CTJSONParse2(alloc, JSONString, &start, options, error);
 	CTAllocatorRelease(lalloc);
 	return retVal;
 }
 
-CTObjectRef CTJSONParse2(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error)
+#define CTJSON_PARSE_INLINE_FRAMES 0x20
+
+typedef enum
+{
+	CTJSON_PARSE_STATE_OPEN,
+	CTJSON_PARSE_STATE_KEY,
+	CTJSON_PARSE_STATE_VALUE,
+	CTJSON_PARSE_STATE_NEXT
+} CTJSON_PARSE_STATE;
+
+typedef struct
+{
+	CTObjectRef container;
+	CTObjectRef key;
+	CTObjectRef value;
+	CTJSON_PARSE_STATE state;
+} CTJSONParseFrame;
+
+static CTObjectRef CTJSONParseValue(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error, char * open)
 {
-	CTObjectRef retVal = CTObjectCreate(alloc, NULL, CTOBJECT_NOT_AN_OBJECT);
 	if (CTStringLength(JSON))
 	{
 		for (;*start < CTStringLength(JSON); (*start)++)
@@ -53,9 +68,10 @@ CTObjectRef CTJSONParse2(CTAllocatorRef alloc, const CTString * restrict JSON, u
 				switch (CTStringUTF8String(JSON)[*start])
 				{
 					case '{':
-						return CTDictionaryFromJSON(alloc, JSON, start, options, error);
 					case '[':
-						return CTArrayFromJSON(alloc, JSON, start, options, error);
+						// Dictionaries and arrays are filled in by CTJSONParse2, which keeps its own stack of them
+						*open = CTStringUTF8String(JSON)[*start];
+						return NULL;
 					case '"':
 					case '\'':
 						return CTStringFromJSON(alloc, JSON, start, options, error);
@@ -87,91 +103,182 @@ CTObjectRef CTJSONParse2(CTAllocatorRef alloc, const CTString * restrict JSON, u
 			*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
 		}
 	}
-	return retVal;
+	return CTObjectCreate(alloc, NULL, CTOBJECT_NOT_AN_OBJECT);
 }
 
-CTObjectRef CTDictionaryFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error)
+static void CTJSONParseAddEntry(CTJSONParseFrame * frame)
+{
+	if (CTObjectNonNilAndType(frame->key, CTOBJECT_TYPE_STRING) && frame->value)
+	{
+		CTDictionaryAddEntry(frame->container->ptr, CTStringUTF8String(CTObjectValue(frame->key)), frame->value);
+		CTObjectRelease(frame->key);
+		frame->key = frame->value = NULL;
+	}
+}
+
+/**
+ * Move a dictionary being parsed along until it needs its next key or value, or is complete.
+ * @return	Returns 1 when the frame's state says whether a key or a value has to be parsed next, 0 when the dictionary is complete.
+ **/
+static uint8_t CTJSONParseDictionary(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONParseFrame * frame, CTErrorRef * error)
 {
-	CTDictionaryRef dictionary = CTDictionaryCreate(alloc);
-	CTObjectRef key = NULL;
-	CTObjectRef value = NULL;
 	const char * err = "Formatting error in dictionary";
-	++(*start);
 	const char * JSONC = CTStringUTF8String(JSON);
-	
-	if (*start < CTStringLength(JSON))
+	uint8_t next = frame->state != CTJSON_PARSE_STATE_OPEN;
+	if (!next && *start >= CTStringLength(JSON))
 	{
-		do
+		return 0;
+	}
+	for (;;)
+	{
+		if (next)
 		{
-			if (JSONC[*start] != '}')
+			if (!(*start < CTStringLength(JSON) && JSONC[(*start)++] != '}'))
 			{
-				if (isgraph(JSONC[*start]))
-				{
-					switch (JSONC[*start])
-					{
-						case '"':
-						case '\'':
-							key = CTJSONParse2(alloc, JSON, start, options, error);
-							break;
-						case ':':
-							++(*start);
-							value = CTJSONParse2(alloc, JSON, start, options, error);
-							break;
-						case ',':
-							break;
-						default:
-							if (error)
-							{
-								*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
-							}
-							return CTObjectCreate(alloc, dictionary, CTOBJECT_TYPE_DICTIONARY);
-					}
-					if (CTObjectNonNilAndType(key, CTOBJECT_TYPE_STRING) && value)
+				break;
+			}
+		}
+		next = 1;
+		if (JSONC[*start] != '}' && isgraph(JSONC[*start]))
+		{
+			switch (JSONC[*start])
+			{
+				case '"':
+				case '\'':
+					frame->state = CTJSON_PARSE_STATE_KEY;
+					return 1;
+				case ':':
+					++(*start);
+					frame->state = CTJSON_PARSE_STATE_VALUE;
+					return 1;
+				case ',':
+					break;
+				default:
+					if (error)
 					{
-						CTDictionaryAddEntry(dictionary, CTStringUTF8String(CTObjectValue(key)), value);
-						CTObjectRelease(key);
-						key = value = NULL;
+						*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
 					}
-				}
+					return 0;
 			}
-		} while (*start < CTStringLength(JSON) && JSONC[(*start)++] != '}');
+			CTJSONParseAddEntry(frame);
+		}
 	}
-	
-	if ((key || value) && !(key && value))
+	if ((frame->key || frame->value) && !(frame->key && frame->value))
 	{
 		if (error)
 		{
 			*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
 		}
 	}
-	return CTObjectCreate(alloc, dictionary, CTOBJECT_TYPE_DICTIONARY);
+	return 0;
 }
 
-CTObjectRef CTArrayFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error)
+/**
+ * Move an array being parsed along until it needs its next element, or is complete.
+ * @return	Returns 1 when an element has to be parsed next, 0 when the array is complete.
+ **/
+static uint8_t CTJSONParseArray(const CTString * restrict JSON, uint64_t * start, CTJSONParseFrame * frame)
 {
-    CTArrayRef array = CTArrayCreate(alloc);
-	++(*start);
 	const char * JSONC = CTStringUTF8String(JSON);
-    while (*start < CTStringLength(JSON))
+	uint8_t next = frame->state != CTJSON_PARSE_STATE_OPEN;
+	for (;;)
 	{
-		switch (JSONC[*start])
-        {
-			case ',':
-            case ']':
-				break;
-			default:
-				CTArrayAddEntry2(array, CTJSONParse2(alloc, JSON, start, options, error));
-				break;
+		if (next && JSONC[(*start)++] == ']')
+		{
+			return 0;
+		}
+		next = 1;
+		if (!(*start < CTStringLength(JSON)))
+		{
+			return 0;
+		}
+		if (JSONC[*start] != ',' && JSONC[*start] != ']')
+		{
+			frame->state = CTJSON_PARSE_STATE_VALUE;
+			return 1;
 		}
-		if (JSONC[(*start)++] == ']') break;
 	}
-	return CTObjectCreate(alloc, array, CTOBJECT_TYPE_ARRAY);
+}
+
+CTObjectRef CTJSONParse2(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error)
+{
+	// Nested dictionaries and arrays are kept on a stack of their own rather than the C stack, so the depth of a document is only limited by memory
+	CTJSONParseFrame inline_frames[CTJSON_PARSE_INLINE_FRAMES];
+	CTJSONParseFrame * frames = inline_frames;
+	uint64_t capacity = CTJSON_PARSE_INLINE_FRAMES, depth = 0;
+	char open = 0;
+	CTObjectRef value = CTJSONParseValue(alloc, JSON, start, options, error, &open);
+	for (;;)
+	{
+		if (open)
+		{
+			if (depth == capacity)
+			{
+				frames = stackGrow(frames, inline_frames, &capacity, sizeof(CTJSONParseFrame));
+			}
+			CTObjectRef container = open == '{' ? CTObjectWithDictionary(alloc, CTDictionaryCreate(alloc)) : CTObjectWithArray(alloc, CTArrayCreate(alloc));
+			frames[depth++] = (CTJSONParseFrame){container, NULL, NULL, CTJSON_PARSE_STATE_OPEN};
+			++(*start);
+			open = 0;
+		}
+		else if (!depth)
+		{
+			break;
+		}
+		else
+		{
+			CTJSONParseFrame * frame = &frames[depth - 1];
+			if (frame->container->type == CTOBJECT_TYPE_ARRAY)
+			{
+				CTArrayAddEntry2(frame->container->ptr, value);
+			}
+			else
+			{
+				if (frame->state == CTJSON_PARSE_STATE_KEY)
+				{
+					frame->key = value;
+				}
+				else
+				{
+					frame->value = value;
+				}
+				CTJSONParseAddEntry(frame);
+			}
+			frame->state = CTJSON_PARSE_STATE_NEXT;
+		}
+		CTJSONParseFrame * frame = &frames[depth - 1];
+		uint8_t more = frame->container->type == CTOBJECT_TYPE_ARRAY ? CTJSONParseArray(JSON, start, frame) : CTJSONParseDictionary(alloc, JSON, start, frame, error);
+		if (more)
+		{
+			value = CTJSONParseValue(alloc, JSON, start, options, error, &open);
+		}
+		else
+		{
+			value = frame->container;
+			--depth;
+		}
+	}
+	stackRelease(frames, inline_frames);
+	return value;
 }
 
 CTObjectRef CTStringFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTJSONOptions options, CTErrorRef * error)
 {
-    CTStringRef string = CTStringCreate(alloc, "");
 	const char * JSONC = CTStringUTF8String(JSON);
+	const char quote = options & CTJSONOptionsSingleQuoteStrings ? '\'' : '"';
+	uint64_t end = *start + 1;
+	while (end < CTStringLength(JSON) && JSONC[end] != quote && JSONC[end] != '\\')
+	{
+		++end;
+	}
+	if (end < CTStringLength(JSON) && JSONC[end] == quote)
+	{
+		// Strings without escapes are copied straight out of the JSON
+		CTObjectRef retVal = CTObjectWithCharacters(alloc, &JSONC[*start + 1], end - *start - 1);
+		*start = end;
+		return retVal;
+	}
+    CTStringRef string = CTStringCreate(alloc, "");
 	char character[3];
 	uint64_t string_start_for_errors = *start;
 	for (++(*start); *start < CTStringLength(JSON) && JSONC[*start] != (options & CTJSONOptionsSingleQuoteStrings ? '\'' : '"'); ++(*start))
@@ -276,7 +383,24 @@ CTObjectRef CTStringFromJSON(CTAllocatorRef alloc, const CTString * restrict JSO
 		}
 		++(*start);
 	}
-	return CTObjectWithString(alloc, string);
+	CTObjectRef retVal = CTObjectWithCharacters(alloc, CTStringUTF8String(string), CTStringLength(string));
+	CTStringRelease(string);
+	return retVal;
+}
+
+#define CTJSON_NUMBER_INLINE_CHARACTERS 0x40
+
+/**
+ * Append a character to one of the buffers CTNumberFromJSON scans a number into, keeping it terminated.
+ **/
+static inline void CTNumberAppendCharacter(char ** characters, const char * inline_characters, uint64_t * length, uint64_t * capacity, char character)
+{
+	if (*length + 1 == *capacity)
+	{
+		*characters = stackGrow(*characters, inline_characters, capacity, sizeof(char));
+	}
+	(*characters)[(*length)++] = character;
+	(*characters)[*length] = 0;
 }
 
 CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSON, uint64_t * start, CTErrorRef * error)
@@ -284,9 +408,13 @@ CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSO
 	assert(alloc);
 	CTObjectRef retVal = NULL;
 	const char * err = NULL;
-	CTAllocatorRef allocl = CTAllocatorCreate();
-	CTStringRef numberString = CTStringCreate(allocl, "");
-	CTStringRef exponentString = CTStringCreate(allocl, "");
+	// Numbers are scanned into buffers on the C stack, only numbers longer than any double or 64 bit integer spill onto the heap
+	char inline_number[CTJSON_NUMBER_INLINE_CHARACTERS] = "";
+	char inline_exponent[CTJSON_NUMBER_INLINE_CHARACTERS] = "";
+	char * number = inline_number, * exponentCharacters = inline_exponent;
+	uint64_t numberLength = 0, exponentLength = 0;
+	uint64_t numberCapacity = CTJSON_NUMBER_INLINE_CHARACTERS, exponentCapacity = CTJSON_NUMBER_INLINE_CHARACTERS;
+	uint8_t isDouble = 0;
 	char * pEnd = NULL;
 	
 	const char * JSONC = CTStringUTF8String(JSON);
@@ -295,29 +423,22 @@ CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSO
 	{
 		if (JSONC[*start] == '-' || JSONC[*start] == '+')
 		{
-			CTStringAppendCharacter(numberString, JSONC[(*start)++]);
+			CTNumberAppendCharacter(&number, inline_number, &numberLength, &numberCapacity, JSONC[(*start)++]);
 		}
 	}
 	
 	while (*start < CTStringLength(JSON) && (isdigit(JSONC[*start]) || JSONC[*start] == '.'))
 	{
-		if (JSONC[*start] == '.' && CTStringContainsString(numberString, "."))
+		if (JSONC[*start] == '.' && isDouble)
 		{
 			err = "A number was found that contained more than one decimal point";
-			if (error)
-			{
-				*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
-			}
 			while (*start < CTStringLength(JSON) && JSONC[*start] != ',' && JSONC[*start] != ']' && JSONC[*start] != '}') ++(*start);
 		}
-		CTStringAppendCharacter(numberString, JSONC[(*start)++]);
-		if (CTStringLength(numberString) > 1 && CTStringUTF8String(numberString)[0] == '0' && !CTStringContainsString(numberString, "."))
+		isDouble |= JSONC[*start] == '.';
+		CTNumberAppendCharacter(&number, inline_number, &numberLength, &numberCapacity, JSONC[(*start)++]);
+		if (numberLength > 1 && number[0] == '0' && !isDouble)
 		{
 			err = "A number was found that started with zero";
-			if (error)
-			{
-				*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
-			}
 			while (*start < CTStringLength(JSON) && JSONC[*start] != ',' && JSONC[*start] != ']' && JSONC[*start] != '}') ++(*start);
 		}
 	}
@@ -327,7 +448,7 @@ CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSO
 		++(*start);
 		if (*start < CTStringLength(JSON) && JSONC[*start] == '-')
 		{
-			CTStringAppendCharacter(exponentString, JSONC[(*start)++]);
+			CTNumberAppendCharacter(&exponentCharacters, inline_exponent, &exponentLength, &exponentCapacity, JSONC[(*start)++]);
 		}
 		else if (*start < CTStringLength(JSON) && JSONC[*start] == '+')
 		{
@@ -336,31 +457,45 @@ CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSO
 		
 		while (*start < CTStringLength(JSON) && isdigit(JSONC[*start]))
 		{
-			CTStringAppendCharacter(exponentString, JSONC[(*start)++]);
+			CTNumberAppendCharacter(&exponentCharacters, inline_exponent, &exponentLength, &exponentCapacity, JSONC[(*start)++]);
 		}
 		
 		if (*start < CTStringLength(JSON) && JSONC[*start] == '.')
 		{
 			err = "E notation cannot be a floating point number";
-			if (error)
-			{
-				*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
-			}
 			while (*start < CTStringLength(JSON) && JSONC[*start] != ',' && JSONC[*start] != ']' && JSONC[*start] != '}') ++(*start);
 		}
 	}
 	
-	long exponent = strtol(CTStringUTF8String(exponentString), &pEnd, 0);
-	if (CTStringContainsString(numberString, "."))
+	long exponent = strtol(exponentCharacters, &pEnd, 0);
+	uint8_t hasExponent = exponentLength != 0;
+	double Double = 0;
+	int64_t Long = 0;
+	if (isDouble)
+	{
+		Double = strtod(number, &pEnd);
+	}
+	else
+	{
+		Long = strtoll(number, &pEnd, 0);
+	}
+	stackRelease(number, inline_number);
+	stackRelease(exponentCharacters, inline_exponent);
+	
+	if (err && error)
+	{
+		*error = CTErrorCreate(alloc, err, CTJSON_PARSE_ERROR);
+	}
+	
+	if (isDouble)
 	{
-		double Double = strtod(CTStringUTF8String(numberString), &pEnd);
 		if (pEnd && pEnd != JSONC)
 		{
-			if (CTStringLength(exponentString))
+			if (hasExponent)
 			{
 				if (exponent <= 15)
 				{
-					retVal = CTObjectWithNumber(alloc, CTNumberCreateWithDouble(alloc, Double * pow(10, exponent)));
+					retVal = CTObjectWithDouble(alloc, Double * pow(10, exponent));
 				}
 				else
 				{
@@ -369,18 +504,17 @@ CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSO
 			}
 			else
 			{
-				retVal = CTObjectWithNumber(alloc, CTNumberCreateWithDouble(alloc, Double));
+				retVal = CTObjectWithDouble(alloc, Double);
 			}
 		}
 	}
 	else
 	{
-		int64_t Long = strtoll(CTStringUTF8String(numberString), &pEnd, 0);
-		if (CTStringLength(exponentString))
+		if (hasExponent)
 		{
 			if (exponent <= 15)
 			{
-				retVal = CTObjectWithNumber(alloc, CTNumberCreateWithDouble(alloc, Long * pow(10, exponent)));
+				retVal = CTObjectWithDouble(alloc, Long * pow(10, exponent));
 			}
 			else
 			{
@@ -389,10 +523,9 @@ CTObjectRef CTNumberFromJSON(CTAllocatorRef alloc, const CTString * restrict JSO
 		}
 		else
 		{
-			retVal = CTObjectWithNumber(alloc, CTNumberCreateWithLong(alloc, Long));
+			retVal = CTObjectWithLong(alloc, Long);
 		}
 	}
-	CTAllocatorRelease(allocl);
 	return retVal;
 }
 
@@ -408,20 +541,20 @@ CTObjectRef CTLiteralFromJSON(CTAllocatorRef alloc, const CTString * restrict JS
 			if (CTStringLength(JSON) - *start >= size && !strncmp(JSONC + *start, "true", size))
 			{
 				*start += size;
-				return CTObjectCreate(alloc, CTNumberCreateWithUnsignedInt(alloc, 1), CTOBJECT_TYPE_NUMBER);
+				return CTObjectWithBool(1);
 			}
 		case 'f':
 			size = 5;
 			if (CTStringLength(JSON) - *start >= size && !strncmp(JSONC + *start, "false", size))
 			{
 				*start += size;
-				return CTObjectCreate(alloc, CTNumberCreateWithUnsignedInt(alloc, 0), CTOBJECT_TYPE_NUMBER);
+				return CTObjectWithBool(0);
 			}
 		case 'n':
 			if (CTStringLength(JSON) - *start >= size && !strncmp(JSONC + *start, "null", 4))
 			{
 				*start += size;
-				return CTObjectCreate(alloc, CTNullCreate(), CTOBJECT_TYPE_NULL);
+				return CTObjectNull();
 			}
 		default:
 			if (error)
@@ -433,61 +566,89 @@ CTObjectRef CTLiteralFromJSON(CTAllocatorRef alloc, const CTString * restrict JS
 	return CTObjectCreate(alloc, NULL, CTOBJECT_NOT_AN_OBJECT);
 }
 
-CTStringRef CTJSONSerialise(CTAllocatorRef alloc, const CTObject * restrict JSON, CTJSONOptions options)
+typedef struct
 {
-    CTStringRef retVal = CTStringCreate(alloc, "");
-    CTJSONSerialiseRecursive(alloc, retVal, CTObjectValue(JSON), CTObjectType(JSON), options);
-    return retVal;
-}
-
-void CTJSONSerialiseRecursive(CTAllocatorRef alloc, CTStringRef JSON, void * obj, CTOBJECT_TYPE type, CTJSONOptions options)
-{
-    uint64_t count = 0;
-    
-    if (type == CTOBJECT_TYPE_DICTIONARY)
-    {
-        count = CTDictionaryCount(obj);
-        CTStringAppendCharacter(JSON, '{');
-    }
-    else if (type == CTOBJECT_TYPE_ARRAY)
-    {
-        count = CTArrayCount(obj);
-        CTStringAppendCharacter(JSON, '[');
-    }
-	
-	switch (type)
+	CTStringRef JSON;
+	char quote;
+} CTJSONSerialiseContext;
+
+static void CTJSONSerialiseString(CTStringRef JSON, const char * characters, uint64_t length, char quote)
+{
+	// Only the quote character needs escaping, the characters between quotes are appended in runs
+	uint64_t run = 0;
+	CTStringAppendCharacter(JSON, quote);
+	for (uint64_t i = 0; i < length; ++i)
 	{
-		case CTOBJECT_TYPE_STRING:
+		if (characters[i] == quote)
 		{
-			CTAllocatorRef local_alloc = CTAllocatorCreate();
-			CTStringAppendCharacter(JSON, options & CTJSONOptionsSingleQuoteStrings ? '\'' : '"');
-			CTStringAppendCharacters(JSON, CTStringUTF8String(CTStringReplaceCharacterWithCharacters(local_alloc, obj, ^const char *(const char character) {
-				if (options & CTJSONOptionsSingleQuoteStrings)
-				{
-					return character == '\'' ? "\\'" : NULL;
-				}
-				return character == '"' ? "\\\"" : NULL;
-			})), CTSTRING_NO_LIMIT);
-			CTStringAppendCharacter(JSON, options & CTJSONOptionsSingleQuoteStrings ? '\'' : '"');
-			CTAllocatorRelease(local_alloc);
-			break;
+			CTStringAppendCharacters(JSON, characters + run, i - run);
+			CTStringAppendCharacter(JSON, '\\');
+			run = i;
 		}
+	}
+	CTStringAppendCharacters(JSON, characters + run, length - run);
+	CTStringAppendCharacter(JSON, quote);
+}
+
+static void CTJSONSerialiseSeparator(CTJSONSerialiseContext * context, const CTObject * parent, uint64_t index)
+{
+	if (!parent)
+	{
+		return;
+	}
+	if (index)
+	{
+		CTStringAppendCharacter(context->JSON, ',');
+	}
+	if (parent->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		CTStringRef key = CTDictionaryEntryKey(CTDictionaryEntryAtIndex(parent->ptr, index));
+		CTStringAppendCharacter(context->JSON, context->quote);
+		CTStringAppendCharacters(context->JSON, CTStringUTF8String(key), CTSTRING_NO_LIMIT);
+		CTStringAppendCharacter(context->JSON, context->quote);
+		CTStringAppendCharacter(context->JSON, ':');
+	}
+}
+
+static uint8_t CTJSONSerialiseEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTJSONSerialiseContext * context = walker->context;
+	CTJSONSerialiseSeparator(context, parent, index);
+	CTStringAppendCharacter(context->JSON, object->type == CTOBJECT_TYPE_DICTIONARY ? '{' : '[');
+	return 1;
+}
+
+static void CTJSONSerialiseLeave(CTObjectWalker * walker, const CTObject * object)
+{
+	CTJSONSerialiseContext * context = walker->context;
+	CTStringAppendCharacter(context->JSON, object->type == CTOBJECT_TYPE_DICTIONARY ? '}' : ']');
+}
+
+static void CTJSONSerialiseScalar(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTJSONSerialiseContext * context = walker->context;
+	CTStringRef JSON = context->JSON;
+	void * obj = object->ptr;
+	CTJSONSerialiseSeparator(context, parent, index);
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_STRING:
+			CTJSONSerialiseString(JSON, CTStringUTF8String(obj), CTStringLength(obj), context->quote);
+			break;
 		case CTOBJECT_TYPE_NUMBER:
 		{
+			// Numbers with a fractional part are below 2^64, so neither format can outgrow the buffer
+			char str[0x40];
 			double intpart;
 			if (CTNumberType(obj) == CTNUMBER_TYPE_DOUBLE && modf(CTNumberDoubleValue(obj), &intpart))
 			{
-				char str[(unsigned)ceil(log10(CTNumberDoubleValue(obj)) + 0x10)];
-				sprintf(str, "%Lf", CTNumberDoubleValue(obj));
-				CTStringAppendCharacters(JSON, str, CTSTRING_NO_LIMIT);
+				snprintf(str, sizeof(str), "%Lf", CTNumberDoubleValue(obj));
 			}
 			else
 			{
-				char str[(unsigned)ceil(log10(CTNumberLongValue(obj)) + 1)];
-				sprintf(str, "%lli", CTNumberLongValue(obj));
-				CTStringAppendCharacters(JSON, str, CTSTRING_NO_LIMIT);
+				snprintf(str, sizeof(str), "%" PRId64, CTNumberLongValue(obj));
 			}
-			
+			CTStringAppendCharacters(JSON, str, CTSTRING_NO_LIMIT);
 			break;
 		}
 		case CTOBJECT_TYPE_NULL:
@@ -495,60 +656,539 @@ void CTJSONSerialiseRecursive(CTAllocatorRef alloc, CTStringRef JSON, void * obj
 			break;
 		case CTOBJECT_TYPE_LARGE_NUMBER:
 		{
-			char str[(unsigned)(ceil(log10(CTNumberDoubleValue(CTLargeNumberBase(obj)))) + 7 + ceil(log10(CTNumberLongValue(CTLargeNumberBase(obj)) + 1))) + 1];
+			// The base of a large number can be of any magnitude, so the buffer is sized by a first pass of snprintf
+			const int64_t exponent = CTNumberLongValue(CTLargeNumberExponent(obj));
 			if (CTNumberType(CTLargeNumberBase(obj)) == CTNUMBER_TYPE_DOUBLE)
 			{
-				sprintf(str, "%Lfe%lli", CTNumberDoubleValue(CTLargeNumberBase(obj)), CTNumberLongValue(CTLargeNumberExponent(obj)));
+				const long double base = CTNumberDoubleValue(CTLargeNumberBase(obj));
+				char str[snprintf(NULL, 0, "%Lfe%" PRId64, base, exponent) + 1];
+				snprintf(str, sizeof(str), "%Lfe%" PRId64, base, exponent);
+				CTStringAppendCharacters(JSON, str, CTSTRING_NO_LIMIT);
 			}
 			else
 			{
-				sprintf(str, "%llie%lli", CTNumberLongValue(CTLargeNumberBase(obj)), CTNumberLongValue(CTLargeNumberExponent(obj)));
+				const int64_t base = CTNumberLongValue(CTLargeNumberBase(obj));
+				char str[snprintf(NULL, 0, "%" PRId64 "e%" PRId64, base, exponent) + 1];
+				snprintf(str, sizeof(str), "%" PRId64 "e%" PRId64, base, exponent);
+				CTStringAppendCharacters(JSON, str, CTSTRING_NO_LIMIT);
 			}
-			CTStringAppendCharacters(JSON, str, CTSTRING_NO_LIMIT);
 			break;
 		}
-			
 		default:
+			break;
+	}
+}
+
+CTStringRef CTJSONSerialise(CTAllocatorRef alloc, const CTObject * restrict JSON, CTJSONOptions options)
+{
+	CTStringRef retVal = CTStringCreate(alloc, "");
+	CTJSONSerialiseContext context = {retVal, options & CTJSONOptionsSingleQuoteStrings ? '\'' : '"'};
+	CTObjectWalker walker = {CTJSONSerialiseEnter, CTJSONSerialiseLeave, CTJSONSerialiseScalar, &context, NULL};
+	CTObjectWalk(JSON, &walker);
+	return retVal;
+}
+
+#define CTJSON_DIFF_INLINE_PATHS 0x400
+#define CTJSON_DIFF_INLINE_SLOTS 0x40
+
+/**
+ * A JSON Pointer kept in the path stack of a CTObjectDiffContext, as an offset rather than a pointer, since the stack moves as it grows.
+ **/
+typedef struct
+{
+	uint64_t start;
+	uint64_t length;
+} CTObjectDiffPathSpan;
+
+typedef struct
+{
+	const CTObject * object1;
+	const CTObject * object2;
+	CTObjectDiffPathSpan path;
+} CTObjectDiffFrame;
+
+typedef struct
+{
+	CTAllocatorRef alloc;
+	CTArrayRef operations;
+	CTObjectDiffFrame * frames;
+	uint64_t count;
+	uint64_t capacity;
+	CTObjectDiffFrame inline_frames[CTJSON_PARSE_INLINE_FRAMES];
+	char * paths;
+	uint64_t paths_length;
+	uint64_t paths_capacity;
+	char inline_paths[CTJSON_DIFF_INLINE_PATHS];
+} CTObjectDiffContext;
+
+static void CTObjectDiffPathAppend(CTObjectDiffContext * context, const char * characters, uint64_t length)
+{
+	while (context->paths_length + length > context->paths_capacity)
+	{
+		context->paths = stackGrow(context->paths, context->inline_paths, &context->paths_capacity, sizeof(char));
+	}
+	memcpy(context->paths + context->paths_length, characters, length);
+	context->paths_length += length;
+}
+
+static CTObjectDiffPathSpan CTObjectDiffPath(CTObjectDiffContext * context, CTObjectDiffPathSpan parent, const char * segment, uint64_t length)
+{
+	// Paths are pushed onto a stack and popped once their operation is made or their frame is done, see CTObjectDiff
+	CTObjectDiffPathSpan path = {context->paths_length, 0};
+	// The parent is copied from below the top of the stack, which may move as it grows, so room is made first
+	while (context->paths_length + parent.length > context->paths_capacity)
+	{
+		context->paths = stackGrow(context->paths, context->inline_paths, &context->paths_capacity, sizeof(char));
+	}
+	memcpy(context->paths + context->paths_length, context->paths + parent.start, parent.length);
+	context->paths_length += parent.length;
+	// JSON Pointers escape '~' as "~0" and '/' as "~1", the characters between them are appended in runs
+	uint64_t run = 0;
+	CTObjectDiffPathAppend(context, "/", 1);
+	for (uint64_t i = 0; i < length; ++i)
+	{
+		if (segment[i] == '~' || segment[i] == '/')
 		{
-			void * ptr = NULL;
-			CTOBJECT_TYPE valueType = 0;
-			for (uint64_t i = 0; i < count; ++i)
-			{
-				switch (type)
-				{
-					case CTOBJECT_TYPE_DICTIONARY:
-						ptr = CTObjectValue(CTDictionaryEntryValue(CTDictionaryEntryAtIndex(obj, i)));
-						valueType = CTObjectType(CTDictionaryEntryValue(CTDictionaryEntryAtIndex(obj, i)));
-						CTStringAppendCharacter(JSON, options & CTJSONOptionsSingleQuoteStrings ? '\'' : '"');
-						CTStringAppendCharacters(JSON, CTStringUTF8String(CTDictionaryEntryKey(CTDictionaryEntryAtIndex(obj, i))), CTSTRING_NO_LIMIT);
-						CTStringAppendCharacter(JSON, options & CTJSONOptionsSingleQuoteStrings ? '\'' : '"');
-						CTStringAppendCharacter(JSON, ':');
-						break;
-					case CTOBJECT_TYPE_ARRAY:
-						ptr = CTObjectValue(CTArrayObjectAtIndex(obj, i));
-						valueType = CTObjectType(CTArrayObjectAtIndex(obj, i));
-						break;
-					default:
-						break;
-				}
-				
-				CTJSONSerialiseRecursive(alloc, JSON, ptr, valueType, options);
-				
-				if (i < (count - 1))
-				{
-					CTStringAppendCharacter(JSON, ',');
-				}
-			}
-			
-			if (type == CTOBJECT_TYPE_DICTIONARY)
+			CTObjectDiffPathAppend(context, segment + run, i - run);
+			CTObjectDiffPathAppend(context, segment[i] == '~' ? "~0" : "~1", 2);
+			run = i + 1;
+		}
+	}
+	CTObjectDiffPathAppend(context, segment + run, length - run);
+	path.length = context->paths_length - path.start;
+	return path;
+}
+
+static CTObjectDiffPathSpan CTObjectDiffIndexPath(CTObjectDiffContext * context, CTObjectDiffPathSpan parent, uint64_t index)
+{
+	char segment[0x20];
+	snprintf(segment, sizeof(segment), "%" PRIu64, index);
+	return CTObjectDiffPath(context, parent, segment, strlen(segment));
+}
+
+static void CTObjectDiffPathPop(CTObjectDiffContext * context, CTObjectDiffPathSpan path)
+{
+	context->paths_length = path.start;
+}
+
+static void CTObjectDiffOperation(CTObjectDiffContext * context, const char * op, CTObjectDiffPathSpan path, const CTObject * value)
+{
+	CTAllocatorRef alloc = context->alloc;
+	CTDictionaryRef operation = CTDictionaryCreate(alloc);
+	CTDictionaryAddEntry(operation, "op", CTObjectWithCharacters(alloc, op, strlen(op)));
+	CTDictionaryAddEntry(operation, "path", CTObjectWithCharacters(alloc, context->paths + path.start, path.length));
+	if (value)
+	{
+		CTDictionaryAddEntry(operation, "value", CTObjectCopy(alloc, value));
+	}
+	CTArrayAddEntry2(context->operations, CTObjectWithDictionary(alloc, operation));
+	CTObjectDiffPathPop(context, path);
+}
+
+static uint8_t CTObjectDiffUnchanged(const CTObject * restrict object1, const CTObject * restrict object2)
+{
+	if (object1 == object2 || (object1->type == object2->type && object1->ptr == object2->ptr))
+	{
+		// Copies and interned objects share their values
+		return 1;
+	}
+	if (object1->type != object2->type)
+	{
+		return 0;
+	}
+	if ((object1->type == CTOBJECT_TYPE_DICTIONARY || object1->type == CTOBJECT_TYPE_ARRAY) && CTObjectHash(object1) != CTObjectHash(object2))
+	{
+		// Differing hashes are enough to tell a subtree changed, equal ones are confirmed below, as reordered elements and colliding strings hash alike
+		return 0;
+	}
+	return CTObjectCompareExact(object1, object2);
+}
+
+static void CTObjectDiffPair(CTObjectDiffContext * context, const CTObject * restrict object1, const CTObject * restrict object2, CTObjectDiffPathSpan path)
+{
+	if (CTObjectDiffUnchanged(object1, object2))
+	{
+		CTObjectDiffPathPop(context, path);
+	}
+	else if (object1->type == object2->type && (object1->type == CTOBJECT_TYPE_DICTIONARY || object1->type == CTOBJECT_TYPE_ARRAY))
+	{
+		// Changed dictionaries and arrays are diffed once the enclosing one is done, their operations never touch the indices of their parent's, and the frame keeps the path on the stack until then
+		if (context->count == context->capacity)
+		{
+			context->frames = stackGrow(context->frames, context->inline_frames, &context->capacity, sizeof(CTObjectDiffFrame));
+		}
+		context->frames[context->count++] = (CTObjectDiffFrame){object1, object2, path};
+	}
+	else
+	{
+		CTObjectDiffOperation(context, "replace", path, object2);
+	}
+}
+
+static void CTObjectDiffDictionaries(CTObjectDiffContext * context, const CTDictionary * restrict dict1, const CTDictionary * restrict dict2, CTObjectDiffPathSpan path)
+{
+	// The entries of the first dictionary are indexed by key hash with open addressing, so each key of the second is found without a scan
+	uint64_t capacity = 2;
+	while (capacity < dict1->count * 2)
+	{
+		capacity *= 2;
+	}
+	// The table comes from the C stack, or from calloc for larger dictionaries, like the scratch space of hashMatch
+	uint64_t inline_slots[CTJSON_DIFF_INLINE_SLOTS] = {0};
+	uint8_t inline_matched[CTJSON_DIFF_INLINE_SLOTS] = {0};
+	uint64_t * slots = capacity > CTJSON_DIFF_INLINE_SLOTS ? calloc(capacity, sizeof(uint64_t)) : inline_slots;
+	uint8_t * matched = capacity > CTJSON_DIFF_INLINE_SLOTS ? calloc(capacity, 1) : inline_matched;
+	assert(slots && matched);
+	for (uint64_t i = 0; i < dict1->count; ++i)
+	{
+		uint64_t slot = hashMix(CTStringHash(dict1->elements[i]->key)) & (capacity - 1);
+		while (slots[slot])
+		{
+			slot = (slot + 1) & (capacity - 1);
+		}
+		slots[slot] = i + 1;
+	}
+	for (uint64_t i = 0; i < dict2->count; ++i)
+	{
+		CTStringRef key = dict2->elements[i]->key;
+		const hash_t hash = CTStringHash(key);
+		const CTDictionaryEntry * entry = NULL;
+		for (uint64_t slot = hashMix(hash) & (capacity - 1); slots[slot]; slot = (slot + 1) & (capacity - 1))
+		{
+			const uint64_t index = slots[slot] - 1;
+			if (!matched[index] && CTStringHash(dict1->elements[index]->key) == hash && CTStringIsIdentical(dict1->elements[index]->key, key))
 			{
-				CTStringAppendCharacter(JSON, '}');
+				matched[index] = 1;
+				entry = dict1->elements[index];
+				break;
 			}
-			else if (type == CTOBJECT_TYPE_ARRAY)
+		}
+		CTObjectDiffPathSpan child = CTObjectDiffPath(context, path, CTStringUTF8String(key), CTStringLength(key));
+		if (entry)
+		{
+			CTObjectDiffPair(context, entry->value, dict2->elements[i]->value, child);
+		}
+		else
+		{
+			CTObjectDiffOperation(context, "add", child, dict2->elements[i]->value);
+		}
+	}
+	for (uint64_t i = 0; i < dict1->count; ++i)
+	{
+		if (!matched[i])
+		{
+			CTStringRef key = dict1->elements[i]->key;
+			CTObjectDiffOperation(context, "remove", CTObjectDiffPath(context, path, CTStringUTF8String(key), CTStringLength(key)), NULL);
+		}
+	}
+	if (slots != inline_slots)
+	{
+		free(slots);
+		free(matched);
+	}
+}
+
+static void CTObjectDiffArrays(CTObjectDiffContext * context, const CTArray * restrict array1, const CTArray * restrict array2, CTObjectDiffPathSpan path)
+{
+	// Elements inserted or removed in one place leave the rest matched up, once the unchanged beginning and end are skipped
+	const uint64_t count = array1->count < array2->count ? array1->count : array2->count;
+	uint64_t start = 0, end = 0;
+	while (start < count && CTObjectDiffUnchanged(array1->elements[start], array2->elements[start]))
+	{
+		++start;
+	}
+	while (end < count - start && CTObjectDiffUnchanged(array1->elements[array1->count - end - 1], array2->elements[array2->count - end - 1]))
+	{
+		++end;
+	}
+	const uint64_t end1 = array1->count - end, end2 = array2->count - end;
+	uint64_t i = start;
+	for (; i < end1 && i < end2; ++i)
+	{
+		CTObjectDiffPair(context, array1->elements[i], array2->elements[i], CTObjectDiffIndexPath(context, path, i));
+	}
+	for (uint64_t j = i; j < end2; ++j)
+	{
+		CTObjectDiffOperation(context, "add", CTObjectDiffIndexPath(context, path, j), array2->elements[j]);
+	}
+	for (uint64_t j = end1; j > i; --j)
+	{
+		CTObjectDiffOperation(context, "remove", CTObjectDiffIndexPath(context, path, j - 1), NULL);
+	}
+}
+
+CTObjectRef CTObjectDiff(CTAllocatorRef restrict alloc, const CTObject * restrict object1, const CTObject * restrict object2)
+{
+	CTObjectDiffContext context;
+	context.alloc = alloc;
+	context.operations = CTArrayCreate(alloc);
+	context.frames = context.inline_frames;
+	context.count = 0;
+	context.capacity = CTJSON_PARSE_INLINE_FRAMES;
+	// Paths and key tables are only needed while diffing, so they are kept on the C stack and spill onto the heap, never onto the allocator the operations are returned in
+	context.paths = context.inline_paths;
+	context.paths_length = 0;
+	context.paths_capacity = CTJSON_DIFF_INLINE_PATHS;
+	const uint64_t previous = hashPassEnter();
+	CTObjectDiffPair(&context, object1, object2, (CTObjectDiffPathSpan){0, 0});
+	while (context.count)
+	{
+		CTObjectDiffFrame frame = context.frames[--context.count];
+		// The paths of the frames popped before this one are above its own, so they are dropped along with the paths made for them
+		context.paths_length = frame.path.start + frame.path.length;
+		if (frame.object1->type == CTOBJECT_TYPE_DICTIONARY)
+		{
+			CTObjectDiffDictionaries(&context, frame.object1->ptr, frame.object2->ptr, frame.path);
+		}
+		else
+		{
+			CTObjectDiffArrays(&context, frame.object1->ptr, frame.object2->ptr, frame.path);
+		}
+	}
+	stackRelease(context.frames, context.inline_frames);
+	stackRelease(context.paths, context.inline_paths);
+	hashPassLeave(previous);
+	return CTObjectWithArray(alloc, context.operations);
+}
+
+#define CTJSON_PATCH_INLINE_SEGMENT 0x100
+
+typedef enum
+{
+	CTJSON_PATCH_ADD,
+	CTJSON_PATCH_REPLACE,
+	CTJSON_PATCH_REMOVE
+} CTJSON_PATCH_OPERATION;
+
+static uint8_t CTObjectPatchError(CTAllocatorRef alloc, CTErrorRef * error, const char * message, int code)
+{
+	if (error)
+	{
+		*error = CTErrorCreate(alloc, message, code);
+	}
+	return 0;
+}
+
+static const char * CTObjectPatchSegment(const char * pointer, char * segment)
+{
+	// pointer is at the '/' starting the segment, which is unescaped into segment, see CTObjectDiffPath. Unescaping never lengthens a segment, so segment only needs to be as long as the path
+	for (++pointer; *pointer && *pointer != '/'; ++pointer)
+	{
+		if (*pointer == '~')
+		{
+			if (pointer[1] != '0' && pointer[1] != '1')
 			{
-				CTStringAppendCharacter(JSON, ']');
+				return NULL;
 			}
+			*segment++ = *++pointer == '0' ? '~' : '/';
+		}
+		else
+		{
+			*segment++ = *pointer;
+		}
+	}
+	*segment = 0;
+	return pointer;
+}
+
+static uint64_t CTObjectPatchIndex(const char * restrict characters, uint64_t count)
+{
+	// "-" stands for the end of an array, other indices are decimal without leading zeroes
+	const uint64_t length = strlen(characters);
+	if (length == 1 && *characters == '-')
+	{
+		return count;
+	}
+	if (!length || length > 19 || (length > 1 && *characters == '0'))
+	{
+		return CT_NOT_FOUND;
+	}
+	uint64_t index = 0;
+	for (uint64_t i = 0; i < length; ++i)
+	{
+		if (!isdigit(characters[i]))
+		{
+			return CT_NOT_FOUND;
+		}
+		index = index * 10 + characters[i] - '0';
+	}
+	return index;
+}
+
+static CTObjectRef CTObjectPatchChild(CTObjectRef object, const char * restrict segment)
+{
+	if (object->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		CTDictionaryRef dict = CTObjectMutableValue(object);
+		const uint64_t index = CTDictionaryIndexOfEntry(dict, segment);
+		return index == CT_NOT_FOUND ? NULL : dict->elements[index]->value;
+	}
+	if (object->type == CTOBJECT_TYPE_ARRAY)
+	{
+		CTArrayRef array = CTObjectMutableValue(object);
+		const uint64_t index = CTObjectPatchIndex(segment, array->count);
+		return index < array->count ? array->elements[index] : NULL;
+	}
+	return NULL;
+}
+
+static uint8_t CTObjectPatchDictionary(CTDictionaryRef dict, const char * restrict key, CTJSON_PATCH_OPERATION operation, const CTObject * restrict value)
+{
+	const uint64_t index = CTDictionaryIndexOfEntry(dict, key);
+	if (operation == CTJSON_PATCH_REMOVE)
+	{
+		if (index != CT_NOT_FOUND)
+		{
+			CTDictionaryDeleteEntry(dict, key);
+		}
+		return index != CT_NOT_FOUND;
+	}
+	if (index != CT_NOT_FOUND)
+	{
+		// add replaces existing members as well
+		assert(!dict->references);
+		dict->hash_pass = 0;
+		CTObjectRelease(dict->elements[index]->value);
+		dict->elements[index]->value = CTObjectCopy(dict->alloc, value);
+		return 1;
+	}
+	if (operation == CTJSON_PATCH_ADD)
+	{
+		CTDictionaryAddEntry(dict, key, CTObjectCopy(dict->alloc, value));
+		return 1;
+	}
+	return 0;
+}
+
+static uint8_t CTObjectPatchArray(CTArrayRef array, const char * restrict segment, CTJSON_PATCH_OPERATION operation, const CTObject * restrict value)
+{
+	const uint64_t index = CTObjectPatchIndex(segment, array->count);
+	if (index == CT_NOT_FOUND || index > array->count || (index == array->count && operation != CTJSON_PATCH_ADD))
+	{
+		return 0;
+	}
+	switch (operation)
+	{
+		case CTJSON_PATCH_ADD:
+		{
+			// The new element is appended and moved into place, shifting the ones after it along
+			CTObjectRef copy = CTObjectCopy(array->alloc, value);
+			CTArrayAddEntry2(array, copy);
+			memmove(array->elements + index + 1, array->elements + index, sizeof(CTObjectRef) * (array->count - index - 1));
+			array->elements[index] = copy;
+			break;
+		}
+		case CTJSON_PATCH_REPLACE:
+			assert(!array->references);
+			array->hash_pass = 0;
+			CTObjectRelease(array->elements[index]);
+			array->elements[index] = CTObjectCopy(array->alloc, value);
 			break;
+		case CTJSON_PATCH_REMOVE:
+			CTArrayDeleteEntry(array, index);
+			break;
+	}
+	return 1;
+}
+
+static uint8_t CTObjectPatchOperation(CTObjectRef * object, const CTObject * restrict operation, CTErrorRef * error)
+{
+	CTAllocatorRef alloc = (*object)->alloc ? (*object)->alloc : operation->alloc;
+	// The patch is only read, so its values are read as they are rather than fetched with CTObjectMutableValue
+	const CTDictionary * dict = operation->type == CTOBJECT_TYPE_DICTIONARY ? operation->ptr : NULL;
+	CTObjectRef op = dict ? CTDictionaryObjectForKey(dict, "op") : NULL;
+	CTObjectRef path = dict ? CTDictionaryObjectForKey(dict, "path") : NULL;
+	CTObjectRef value = dict ? CTDictionaryObjectForKey(dict, "value") : NULL;
+	if (!CTObjectNonNilAndType(op, CTOBJECT_TYPE_STRING) || !CTObjectNonNilAndType(path, CTOBJECT_TYPE_STRING))
+	{
+		return CTObjectPatchError(alloc, error, "Patch operations need an op and a path", CTJSON_PATCH_INVALID_OPERATION);
+	}
+	CTJSON_PATCH_OPERATION kind;
+	if (CTStringIsEqual2(op->ptr, "add"))
+	{
+		kind = CTJSON_PATCH_ADD;
+	}
+	else if (CTStringIsEqual2(op->ptr, "replace"))
+	{
+		kind = CTJSON_PATCH_REPLACE;
+	}
+	else if (CTStringIsEqual2(op->ptr, "remove"))
+	{
+		kind = CTJSON_PATCH_REMOVE;
+	}
+	else
+	{
+		return CTObjectPatchError(alloc, error, "Unsupported patch operation", CTJSON_PATCH_INVALID_OPERATION);
+	}
+	if (kind != CTJSON_PATCH_REMOVE && !value)
+	{
+		return CTObjectPatchError(alloc, error, "Patch operation is missing its value", CTJSON_PATCH_INVALID_OPERATION);
+	}
+	const char * pointer = CTStringUTF8String(path->ptr);
+	if (!*pointer)
+	{
+		// The empty pointer is the whole document
+		if (kind == CTJSON_PATCH_REMOVE)
+		{
+			return CTObjectPatchError(alloc, error, "The whole document cannot be removed", CTJSON_PATCH_INVALID_OPERATION);
 		}
+		CTObjectRef replacement = CTObjectCopy(alloc, value);
+		CTObjectRelease(*object);
+		*object = replacement;
+		return 1;
+	}
+	if (*pointer != '/')
+	{
+		return CTObjectPatchError(alloc, error, "Patch path is not a JSON Pointer", CTJSON_PATCH_INVALID_OPERATION);
+	}
+	// Segments are unescaped into a buffer on the C stack, only paths longer than it spill onto the heap
+	char inline_segment[CTJSON_PATCH_INLINE_SEGMENT];
+	const uint64_t length = CTStringLength(path->ptr);
+	char * segment = length < CTJSON_PATCH_INLINE_SEGMENT ? inline_segment : malloc(length + 1);
+	assert(segment);
+	// Every step but the last leads to the dictionary or array to modify
+	CTObjectRef parent = *object;
+	pointer = CTObjectPatchSegment(pointer, segment);
+	while (pointer && *pointer && parent)
+	{
+		parent = CTObjectPatchChild(parent, segment);
+		pointer = CTObjectPatchSegment(pointer, segment);
+	}
+	uint8_t applied = 0;
+	if (!pointer)
+	{
+		CTObjectPatchError(alloc, error, "Patch path is not a JSON Pointer", CTJSON_PATCH_INVALID_OPERATION);
+	}
+	else
+	{
+		if (CTObjectNonNilAndType(parent, CTOBJECT_TYPE_DICTIONARY))
+		{
+			applied = CTObjectPatchDictionary(CTObjectMutableValue(parent), segment, kind, value);
+		}
+		else if (CTObjectNonNilAndType(parent, CTOBJECT_TYPE_ARRAY))
+		{
+			applied = CTObjectPatchArray(CTObjectMutableValue(parent), segment, kind, value);
+		}
+		if (!applied)
+		{
+			CTObjectPatchError(alloc, error, "Patch path was not found", CTJSON_PATCH_PATH_NOT_FOUND);
+		}
+	}
+	if (segment != inline_segment)
+	{
+		free(segment);
+	}
+	return applied;
+}
+
+CTObjectRef CTObjectApplyPatch(CTObjectRef object, const CTObject * restrict patch, CTErrorRef * error)
+{
+	const CTArray * operations = patch->type == CTOBJECT_TYPE_ARRAY ? patch->ptr : NULL;
+	if (!operations)
+	{
+		CTObjectPatchError(object->alloc ? object->alloc : patch->alloc, error, "Patches are arrays of operations", CTJSON_PATCH_INVALID_OPERATION);
+		return object;
 	}
+	for (uint64_t i = 0; i < operations->count && CTObjectPatchOperation(&object, operations->elements[i], error); ++i);
+	return object;
 }
@@ -27,4 +27,29 @@ typedef uint64_t CTJSONOptions;
 #include "CTError.h"
 
 CTObjectRef CTJSONParse(CTAllocatorRef restrict alloc, const char * restrict JSON, CTJSONOptions options, CTErrorRef * error);
-CTStringRef CTJSONSerialise(CTAllocatorRef restrict alloc, const CTObject * restrict JSON, CTJSONOptions options);
\ No newline at end of file
+CTStringRef CTJSONSerialise(CTAllocatorRef restrict alloc, const CTObject * restrict JSON, CTJSONOptions options);
+
+enum CTJSON_PATCH_ERROR_CODES
+{
+	CTJSON_PATCH_INVALID_OPERATION = -200,
+	CTJSON_PATCH_PATH_NOT_FOUND = -201
+};
+
+/**
+ * Compute the changes that turn one document into another as a JSON Patch, an array of operations such as {"op":"replace","path":"/a/0","value":1} that CTJSONSerialise can send as is, see RFC 6902. Only add, remove and replace operations are produced, with paths given as JSON Pointers.
+ * Subtrees whose structural hashes differ, see CTObjectHash, are known to have changed without comparing them, and subtrees whose hashes match are confirmed with CTObjectCompareExact before they are skipped, so reordered array elements and strings with colliding hashes still produce operations. Dictionary entries are matched by key through a table of their keys' hashes, and arrays are matched element by element once their common beginning and end have been skipped.
+ * @param alloc		A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param object1	The document to start from.
+ * @param object2	The document to end up with. The values of the operations are copies of its values, which share them when alloc is the allocator it was created with, see CTObjectCopy.
+ * @return			Returns an array of operations, which is empty when the documents are equal.
+ **/
+CTObjectRef CTObjectDiff(CTAllocatorRef restrict alloc, const CTObject * restrict object1, const CTObject * restrict object2);
+
+/**
+ * Apply a JSON Patch, such as one made by CTObjectDiff, to a document in place. add, remove and replace operations are supported, and values are copied into the document with the document's allocator. Dictionaries and arrays on the way to each path are fetched with CTObjectMutableValue, so copies of the document are left untouched. Operations are applied in order, and the first one that cannot be applied stops the patch, leaving the operations before it applied.
+ * @param object	The document to modify, which must not be frozen.
+ * @param patch		An array of operations.
+ * @param error		A CTErrorRef pointer that receives an error with one of CTJSON_PATCH_ERROR_CODES if an operation could not be applied, or NULL.
+ * @return			Returns the patched document. This is object itself unless an operation replaced the whole document, in which case object is released.
+ **/
+CTObjectRef CTObjectApplyPatch(CTObjectRef object, const CTObject * restrict patch, CTErrorRef * error);
@@ -68,12 +68,13 @@ long CTNetServerSend(const CTNetServer * restrict server, const char * restrict
 
 const char * CTNetServerReceive(const CTNetServer * restrict server, uint64_t size)
 {
-    CTAllocatorRef alloc = CTAllocatorCreate();
-    char * receive = CTAllocatorAllocate(alloc, size);
-    long receivedLength = recv(server->handle, receive, size, 0);
-    char * retVal = CTAllocatorAllocate(server->alloc, receivedLength + 1);
-    memcpy(retVal, receive, receivedLength);
+    char * retVal = CTAllocatorAllocateAligned(server->alloc, size + 1, 0, CTAllocatorOptionsUninitialised);
+    long receivedLength = recv(server->handle, retVal, size, 0);
+    if (receivedLength < 0)
+    {
+        receivedLength = 0;
+    }
+    retVal = CTAllocatorReallocate(server->alloc, retVal, receivedLength + 1);
     retVal[receivedLength] = 0;
-    CTAllocatorRelease(alloc);
     return retVal;
 }
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "CTNull.h"
 
 CTNull global_null = {.value = "null"};
+static const CTObject global_null_object = {.ptr = &global_null, .type = CTOBJECT_TYPE_NULL};
 
 CTNullRef CTNullCreate(void)
 {
@@ -26,4 +27,9 @@ const char * CTNullValue(CTNullRef null)
 CTObjectRef CTObjectWithNull(CTAllocatorRef alloc, CTNullRef restrict n)
 {
 	return CTObjectCreate(alloc, n, CTOBJECT_TYPE_NULL);
+}
+
+CTObjectRef CTObjectNull(void)
+{
+	return (CTObjectRef)&global_null_object;
 }
\ No newline at end of file
@@ -17,4 +17,10 @@ typedef struct
 
 CTNullRef CTNullCreate(void);
 const char * CTNullValue(CTNullRef null);
-CTObjectRef CTObjectWithNull(CTAllocatorRef alloc, CTNullRef restrict n);
\ No newline at end of file
+CTObjectRef CTObjectWithNull(CTAllocatorRef alloc, CTNullRef restrict n);
+
+/**
+ * Return a shared object wrapping CTNullCreate, which takes no allocations and can be released and copied like any other object but must not be modified.
+ * @return	A shared CTObject of type CTOBJECT_TYPE_NULL.
+ **/
+CTObjectRef CTObjectNull(void);
\ No newline at end of file
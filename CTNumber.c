@@ -7,7 +7,52 @@
 //
 
 #include "CTNumber.h"
+#include "CTFunctions.h"
 #include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#define CTNUMBER_REPEAT_1(F, n) F(n)
+#define CTNUMBER_REPEAT_2(F, n) CTNUMBER_REPEAT_1(F, n), CTNUMBER_REPEAT_1(F, (n) + 1)
+#define CTNUMBER_REPEAT_4(F, n) CTNUMBER_REPEAT_2(F, n), CTNUMBER_REPEAT_2(F, (n) + 2)
+#define CTNUMBER_REPEAT_8(F, n) CTNUMBER_REPEAT_4(F, n), CTNUMBER_REPEAT_4(F, (n) + 4)
+#define CTNUMBER_REPEAT_16(F, n) CTNUMBER_REPEAT_8(F, n), CTNUMBER_REPEAT_8(F, (n) + 8)
+#define CTNUMBER_REPEAT_32(F, n) CTNUMBER_REPEAT_16(F, n), CTNUMBER_REPEAT_16(F, (n) + 16)
+#define CTNUMBER_REPEAT_64(F, n) CTNUMBER_REPEAT_32(F, n), CTNUMBER_REPEAT_32(F, (n) + 32)
+#define CTNUMBER_REPEAT_128(F, n) CTNUMBER_REPEAT_64(F, n), CTNUMBER_REPEAT_64(F, (n) + 64)
+#define CTNUMBER_REPEAT_256(F, n) CTNUMBER_REPEAT_128(F, n), CTNUMBER_REPEAT_128(F, (n) + 128)
+#define CTNUMBER_REPEAT_512(F, n) CTNUMBER_REPEAT_256(F, n), CTNUMBER_REPEAT_256(F, (n) + 256)
+#define CTNUMBER_REPEAT_1024(F, n) CTNUMBER_REPEAT_512(F, n), CTNUMBER_REPEAT_512(F, (n) + 512)
+
+#define CTNUMBER_SHARED_LONG(n) {.alloc = NULL, .value = {.Long = (n)}, .type = CTNUMBER_TYPE_LONG, .references = 0}
+#define CTNUMBER_SHARED_OBJECT(n) {.alloc = NULL, .size = 0, .ptr = (void *)&CTNumberSharedLongs[(n) - CTNUMBER_SHARED_MINIMUM], .type = CTOBJECT_TYPE_NUMBER}
+
+/**
+ * Shared numbers and the objects wrapping them are const, so that modifying one faults instead of changing every document that uses it. They have no allocator, which is how release, adopt and compact tell them apart.
+ **/
+static const CTNumber CTNumberSharedLongs[CTNUMBER_SHARED_MAXIMUM - CTNUMBER_SHARED_MINIMUM + 1] =
+{
+	CTNUMBER_REPEAT_128(CTNUMBER_SHARED_LONG, CTNUMBER_SHARED_MINIMUM),
+	CTNUMBER_REPEAT_1024(CTNUMBER_SHARED_LONG, 0)
+};
+
+static const CTObject CTNumberSharedObjects[CTNUMBER_SHARED_MAXIMUM - CTNUMBER_SHARED_MINIMUM + 1] =
+{
+	CTNUMBER_REPEAT_128(CTNUMBER_SHARED_OBJECT, CTNUMBER_SHARED_MINIMUM),
+	CTNUMBER_REPEAT_1024(CTNUMBER_SHARED_OBJECT, 0)
+};
+
+static const CTNumber CTNumberSharedBools[2] =
+{
+	{.alloc = NULL, .value = {.ULong = 0}, .type = CTNUMBER_TYPE_ULONG, .references = 0},
+	{.alloc = NULL, .value = {.ULong = 1}, .type = CTNUMBER_TYPE_ULONG, .references = 0}
+};
+
+static const CTObject CTNumberSharedBoolObjects[2] =
+{
+	{.alloc = NULL, .size = 0, .ptr = (void *)&CTNumberSharedBools[0], .type = CTOBJECT_TYPE_NUMBER},
+	{.alloc = NULL, .size = 0, .ptr = (void *)&CTNumberSharedBools[1], .type = CTOBJECT_TYPE_NUMBER}
+};
 
 CTNumberRef CTNumberCreate(CTAllocatorRef alloc)
 {
@@ -82,6 +127,33 @@ uint8_t CTLargeNumberCompare(const CTLargeNumber * restrict number1, const CTLar
 	return CTNumberCompare(number1->base, number2->base) && CTNumberCompare(number1->exponent, number2->exponent);
 }
 
+uint64_t CTNumberHash(const CTNumber * restrict number)
+{
+	uint64_t bits = 0;
+	switch (number->type)
+	{
+		case CTNUMBER_TYPE_LONG:
+			bits = number->value.Long;
+			break;
+		case CTNUMBER_TYPE_ULONG:
+			bits = number->value.ULong;
+			break;
+		case CTNUMBER_TYPE_DOUBLE:
+		{
+			// long double has padding bytes, and 0.0 == -0.0
+			double value = number->value.Double ? (double)number->value.Double : 0;
+			memcpy(&bits, &value, sizeof(bits));
+			break;
+		}
+	}
+	return hashMix(hashMix(bits) + number->type);
+}
+
+uint64_t CTLargeNumberHash(const CTLargeNumber * restrict number)
+{
+	return hashMix(CTNumberHash(number->base) + 3 * CTNumberHash(number->exponent));
+}
+
 CTLargeNumberRef CTLargeNumberCreate(CTAllocatorRef restrict alloc, CTNumberRef base, CTNumberRef exponent)
 {
     CTLargeNumberRef lnumber = CTAllocatorAllocate(alloc, sizeof(CTLargeNumber));
@@ -108,11 +180,18 @@ CTNumberRef CTLargeNumberExponent(const CTLargeNumber * restrict number)
 
 void CTNumberRelease(CTNumberRef number)
 {
-    CTAllocatorDeallocate(number->alloc, number);
+	if (number->alloc && !referencesRelease(&number->references))
+	{
+		CTAllocatorDeallocate(number->alloc, number);
+	}
 }
 
 void CTLargeNumberRelease(CTLargeNumberRef lnumber)
 {
+	if (referencesRelease(&lnumber->references))
+	{
+		return;
+	}
 	CTNumberRelease(lnumber->base);
 	CTNumberRelease(lnumber->exponent);
 	CTAllocatorDeallocate(lnumber->alloc, lnumber);
@@ -120,18 +199,21 @@ void CTLargeNumberRelease(CTLargeNumberRef lnumber)
 
 void CTNumberSetUnsignedLongValue(CTNumberRef restrict number, uint64_t value)
 {
+	assert(number->alloc && !number->references);
     number->value.ULong = value;
     number->type = CTNUMBER_TYPE_ULONG;
 }
 
 void CTNumberSetLongValue(CTNumberRef restrict number, int64_t value)
 {
+	assert(number->alloc && !number->references);
     number->value.Long = value;
     number->type = CTNUMBER_TYPE_LONG;
 }
 
 void CTNumberSetDoubleValue(CTNumberRef restrict number, long double value)
 {
+	assert(number->alloc && !number->references);
     number->value.Double = value;
     number->type = CTNUMBER_TYPE_DOUBLE;
 }
@@ -224,4 +306,42 @@ CTObjectRef CTObjectWithNumber(CTAllocatorRef alloc, CTNumberRef restrict n)
 CTObjectRef CTObjectWithLargeNumber(CTAllocatorRef alloc, CTLargeNumberRef restrict n)
 {
 	return CTObjectCreate(alloc, n, CTOBJECT_TYPE_LARGE_NUMBER);
+}
+
+CTNumberRef CTNumberCreateWithBool(uint8_t value)
+{
+	return (CTNumberRef)&CTNumberSharedBools[value != 0];
+}
+
+CTObjectRef CTObjectWithBool(uint8_t value)
+{
+	return (CTObjectRef)&CTNumberSharedBoolObjects[value != 0];
+}
+
+CTObjectRef CTObjectWithLong(CTAllocatorRef restrict alloc, int64_t value)
+{
+	if (value >= CTNUMBER_SHARED_MINIMUM && value <= CTNUMBER_SHARED_MAXIMUM)
+	{
+		return (CTObjectRef)&CTNumberSharedObjects[value - CTNUMBER_SHARED_MINIMUM];
+	}
+	CTObjectRef object = CTObjectCreateWithEmbeddedValue(alloc, sizeof(CTNumber), CTOBJECT_TYPE_NUMBER);
+	((CTNumberRef)object->ptr)->alloc = alloc;
+	CTNumberSetLongValue(object->ptr, value);
+	return object;
+}
+
+CTObjectRef CTObjectWithUnsignedLong(CTAllocatorRef restrict alloc, uint64_t value)
+{
+	CTObjectRef object = CTObjectCreateWithEmbeddedValue(alloc, sizeof(CTNumber), CTOBJECT_TYPE_NUMBER);
+	((CTNumberRef)object->ptr)->alloc = alloc;
+	CTNumberSetUnsignedLongValue(object->ptr, value);
+	return object;
+}
+
+CTObjectRef CTObjectWithDouble(CTAllocatorRef restrict alloc, long double value)
+{
+	CTObjectRef object = CTObjectCreateWithEmbeddedValue(alloc, sizeof(CTNumber), CTOBJECT_TYPE_NUMBER);
+	((CTNumberRef)object->ptr)->alloc = alloc;
+	CTNumberSetDoubleValue(object->ptr, value);
+	return object;
 }
\ No newline at end of file
@@ -11,6 +11,12 @@
 #include "CTObject.h"
 #include <stdint.h>
 
+/**
+ * Integers from CTNUMBER_SHARED_MINIMUM to CTNUMBER_SHARED_MAXIMUM are given shared objects by CTObjectWithLong instead of being allocated.
+ **/
+#define CTNUMBER_SHARED_MINIMUM -128
+#define CTNUMBER_SHARED_MAXIMUM 1023
+
 typedef enum
 {
     CTNUMBER_TYPE_ULONG,
@@ -30,6 +36,7 @@ typedef struct
     CTAllocatorRef alloc;
     union CTNumberValue value;
     CTNUMBER_TYPE type;
+	uint64_t references;
 } CTNumber, * CTNumberRef;
 
 typedef struct
@@ -37,6 +44,7 @@ typedef struct
     CTAllocatorRef alloc;
     CTNumberRef base;
     CTNumberRef exponent;
+	uint64_t references;
 } CTLargeNumber, * CTLargeNumberRef;
 
 CTNumberRef CTNumberCreateWithUnsignedInt(CTAllocatorRef restrict alloc, unsigned int integer);
@@ -54,6 +62,8 @@ CTNumberRef CTNumberCopy(CTAllocatorRef restrict alloc, CTNumberRef number);
  **/
 uint8_t CTNumberCompare(const CTNumber * restrict number1, const CTNumber * restrict number2);
 uint8_t CTLargeNumberCompare(const CTLargeNumber * restrict number1, const CTLargeNumber * restrict number2);
+uint64_t CTNumberHash(const CTNumber * restrict number);
+uint64_t CTLargeNumberHash(const CTLargeNumber * restrict number);
 
 void CTNumberRelease(CTNumberRef number);
 void CTLargeNumberRelease(CTLargeNumberRef lnumber);
@@ -80,4 +90,42 @@ CTNUMBER_TYPE CTNumberType(const CTNumber * restrict number);
  * @return	The CTNumber wrapped in a CTObject. The result is identical to using CTObjectCreate.
  **/
 CTObjectRef CTObjectWithNumber(CTAllocatorRef alloc, CTNumberRef restrict n);
-CTObjectRef CTObjectWithLargeNumber(CTAllocatorRef alloc, CTLargeNumberRef restrict n);
\ No newline at end of file
+CTObjectRef CTObjectWithLargeNumber(CTAllocatorRef alloc, CTLargeNumberRef restrict n);
+
+/**
+ * Return a shared number holding 1 or 0 as an unsigned long. Like CTNullCreate, the number has no allocator, is never deallocated and must not be modified, use CTNumberCopy to get one that can be.
+ * @param value	The boolean to return a number for.
+ * @return		A shared CTNumber.
+ **/
+CTNumberRef CTNumberCreateWithBool(uint8_t value);
+
+/**
+ * Return a shared object wrapping CTNumberCreateWithBool, which takes no allocations.
+ * @param value	The boolean to return an object for.
+ * @return		A shared CTObject, which can be released and copied like any other but must not be modified.
+ **/
+CTObjectRef CTObjectWithBool(uint8_t value);
+
+/**
+ * Return an object holding an integer as a long. Integers between CTNUMBER_SHARED_MINIMUM and CTNUMBER_SHARED_MAXIMUM are given a shared, immutable object and number without allocating, as with CTObjectWithBool, all others are created with alloc.
+ * @param alloc	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param value	The integer to return an object for.
+ * @return		A CTObject of type CTOBJECT_TYPE_NUMBER.
+ **/
+CTObjectRef CTObjectWithLong(CTAllocatorRef restrict alloc, int64_t value);
+
+/**
+ * Return an object holding an unsigned integer. Unlike CTObjectWithLong it never returns a shared object, as those hold longs.
+ * @param alloc	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param value	The integer to return an object for.
+ * @return		A CTObject of type CTOBJECT_TYPE_NUMBER.
+ **/
+CTObjectRef CTObjectWithUnsignedLong(CTAllocatorRef restrict alloc, uint64_t value);
+
+/**
+ * Return an object holding a double. The number is embedded in the object, see CTObjectCreateWithEmbeddedValue, as are those of CTObjectWithLong and CTObjectWithUnsignedLong.
+ * @param alloc	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param value	The double to return an object for.
+ * @return		A CTObject of type CTOBJECT_TYPE_NUMBER.
+ **/
+CTObjectRef CTObjectWithDouble(CTAllocatorRef restrict alloc, long double value);
\ No newline at end of file
@@ -8,9 +8,11 @@
 
 #include "CTPrelude.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <pthread.h>
 
 void recurseJSON(void * obj, int type, int indentation)
 {
@@ -339,8 +341,1118 @@ void CTArrayTests()
 	}
 }
 
+void * CTObjectFrozenReader(void * object)
+{
+	const CTDictionary * routes = CTObjectValue(object);
+	for (int i = 0; i < 0x1000; ++i)
+	{
+		CTObjectRef route = CTObjectRetain(CTDictionaryObjectForKey(routes, "b"));
+		assert(CTObjectIsFrozen(route) && !strcmp(CTStringUTF8String(CTObjectValue(route)), "two"));
+		CTObjectRelease(route);
+	}
+	CTObjectRelease(object);
+	return NULL;
+}
+
+static int CTObjectHolderStop = 0;
+
+void * CTObjectHolderReader(void * holder)
+{
+	uint64_t reads = 0;
+	while (!__atomic_load_n(&CTObjectHolderStop, __ATOMIC_RELAXED))
+	{
+		uint64_t section;
+		const CTDictionary * document = CTObjectValue(CTObjectHolderReadLock(holder, &section));
+		int64_t version = CTNumberLongValue(CTObjectValue(CTDictionaryObjectForKey(document, "version")));
+		assert(CTNumberLongValue(CTObjectValue(CTDictionaryObjectForKey(document, "check"))) == version);
+		CTObjectHolderReadUnlock(holder, section);
+		++reads;
+	}
+	return (void *)reads;
+}
+
+void CTObjectTests()
+{
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef object = CTJSONParse(allocator, "{'a':[1, 2000, 'three', {'b':5000}], 'c':'d'}", CTJSONOptionsSingleQuoteStrings, NULL);
+		CTAllocatorStats before = CTAllocatorGetStats(allocator);
+		CTObjectRef copy = CTObjectCopy(allocator, object);
+		CTAllocatorStats after = CTAllocatorGetStats(allocator);
+		assert(copy != object && copy->ptr == object->ptr && after.allocations - before.allocations == 1);
+		assert(CTObjectCompare(object, copy));
+		CTArrayRef array = CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(copy), "a"));
+		assert(copy->ptr != object->ptr);
+		CTArrayAddEntry2(array, CTObjectWithLong(allocator, 4));
+		CTStringAppendCharacters(CTObjectMutableValue(CTArrayEntry(array, 2)), "!", CTSTRING_NO_LIMIT);
+		CTNumberSetLongValue(CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(CTArrayEntry(array, 3)), "b")), 6000);
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(allocator, object, 0)), "{\"a\":[1,2000,\"three\",{\"b\":5000}],\"c\":\"d\"}"));
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(allocator, copy, 0)), "{\"a\":[1,2000,\"three!\",{\"b\":6000},4],\"c\":\"d\"}"));
+		CTObjectRelease(object);
+		CTObjectRef adopted = CTObjectAdopt(CTAllocatorCreate(), CTObjectCopy(allocator, copy));
+		CTObjectRelease(copy);
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(adopted->alloc, adopted, 0)), "{\"a\":[1,2000,\"three!\",{\"b\":6000},4],\"c\":\"d\"}"));
+		assert(!CTAllocatorGetStats(allocator).objects[CTOBJECT_TYPE_DICTIONARY + 1] && !CTAllocatorGetStats(allocator).objects[CTOBJECT_TYPE_STRING + 1]);
+		CTAllocatorRelease(adopted->alloc);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreateShared();
+		CTObjectRef object = CTJSONParse(allocator, "{'a':'one', 'b':'two', 'c':[1, 2000, 'three']}", CTJSONOptionsSingleQuoteStrings, NULL);
+		CTObjectFreeze(object);
+		CTArrayRef array = CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(object), "c"));
+		assert(CTObjectIsFrozen(object) && CTObjectIsFrozen(CTArrayEntry(array, 1)) && CTObjectRetain(object) == object);
+		CTObjectRelease(object);
+		CTObjectRef thawed = CTObjectCopy(allocator, object);
+		assert(thawed != object && !CTObjectIsFrozen(thawed) && CTObjectCompare(thawed, object));
+		CTArrayAddEntry2(CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(thawed), "c")), CTObjectNull());
+		assert(CTArrayCount(array) == 3 && !CTObjectCompare(thawed, object));
+		CTObjectRelease(thawed);
+		CTAllocatorRef other = CTAllocatorCreate();
+		CTObjectRef copy = CTObjectCopy(other, object);
+		assert(!CTObjectIsFrozen(copy) && CTObjectCompare(copy, object));
+		CTArrayAddEntry2(CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(copy), "c")), CTObjectNull());
+		CTAllocatorRelease(other);
+		pthread_t threads[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			pthread_create(&threads[i], NULL, CTObjectFrozenReader, CTObjectRetain(object));
+		}
+		CTObjectRelease(object);
+		for (int i = 0; i < 4; ++i)
+		{
+			pthread_join(threads[i], NULL);
+		}
+		CTAllocatorStats stats = CTAllocatorGetStats(allocator);
+		assert(!stats.objects[CTOBJECT_TYPE_DICTIONARY + 1] && !stats.objects[CTOBJECT_TYPE_STRING + 1] && !stats.objects[CTOBJECT_TYPE_ARRAY + 1]);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreateShared();
+		CTObjectHolderRef holder = CTObjectHolderCreate(allocator, CTJSONParse(allocator, "{\"version\":2000,\"check\":2000}", 0, NULL));
+		pthread_t threads[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			pthread_create(&threads[i], NULL, CTObjectHolderReader, holder);
+		}
+		for (int i = 1; i <= 0x100; ++i)
+		{
+			char JSON[0x40];
+			sprintf(JSON, "{\"version\":%d,\"check\":%d}", 2000 + i, 2000 + i);
+			CTObjectHolderPublish(holder, CTJSONParse(allocator, JSON, 0, NULL));
+		}
+		__atomic_store_n(&CTObjectHolderStop, 1, __ATOMIC_RELAXED);
+		for (int i = 0; i < 4; ++i)
+		{
+			pthread_join(threads[i], NULL);
+		}
+		assert(CTAllocatorGetStats(allocator).objects[CTOBJECT_TYPE_NUMBER + 1] == 2);
+		CTObjectHolderRelease(holder);
+		assert(!CTAllocatorGetStats(allocator).objects[CTOBJECT_TYPE_DICTIONARY + 1]);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef object1 = CTJSONParse(allocator, "{'a':[1, 'two', {'b':3000}], 'c':1.5}", CTJSONOptionsSingleQuoteStrings, NULL);
+		CTObjectRef object2 = CTJSONParse(allocator, "{'c':1.5, 'a':[{'b':3000}, 1, 'two']}", CTJSONOptionsSingleQuoteStrings, NULL);
+		assert(CTObjectHash(object1) == CTObjectHash(object2) && CTObjectCompare(object1, object2));
+		CTArrayRef array = CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(object2), "a"));
+		CTNumberSetLongValue(CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(CTArrayEntry(array, 0)), "b")), 3001);
+		assert(CTObjectHash(object1) != CTObjectHash(object2) && !CTObjectCompare(object1, object2));
+		CTObjectRef repeated1 = CTJSONParse(allocator, "[1, 1, 2]", 0, NULL), repeated2 = CTJSONParse(allocator, "[1, 2, 2]", 0, NULL);
+		assert(!CTObjectCompare(repeated1, repeated2) && !CTObjectCompare(repeated2, repeated1));
+		// Elements that share their hash with other unmatched ones are compared in full before they are paired, only the last one may be settled later
+		static const uint64_t values1[] = {1, 2, 3}, values2[] = {3, 2, 1};
+		__block uint64_t deferred = 0;
+		assert(hashMatch(3, ^uint64_t(uint8_t second, uint64_t index) {
+			return 0;
+		}, ^uint8_t(uint64_t index1, uint64_t index2, uint8_t only) {
+			deferred += only;
+			return values1[index1] == values2[index2];
+		}) && deferred == 1);
+		CTObjectFreeze(object1);
+		uint64_t hash = CTObjectHash(object1);
+		CTArrayAddEntry2(CTObjectMutableValue(repeated1), CTObjectNull());
+		assert(CTObjectHash(object1) == hash);
+		// Modifying an array from another allocator still reaches the hashes of the arrays it is in
+		CTAllocatorRef other = CTAllocatorCreate();
+		CTObjectRef outer1 = CTJSONParse(allocator, "[[1, 2]]", 0, NULL), outer2 = CTJSONParse(allocator, "[[1, 2]]", 0, NULL);
+		CTArrayAddEntry2(CTObjectMutableValue(outer1), CTJSONParse(other, "[3]", 0, NULL));
+		CTArrayAddEntry2(CTObjectMutableValue(outer2), CTJSONParse(other, "[3]", 0, NULL));
+		assert(CTObjectCompare(outer1, outer2));
+		CTArrayAddEntry2(CTObjectMutableValue(CTArrayEntry(CTObjectMutableValue(outer2), 1)), CTObjectNull());
+		assert(!CTObjectCompare(outer1, outer2) && CTObjectHash(outer1) != CTObjectHash(outer2));
+		// Modifying a dictionary through a value fetched before its parent was hashed still reaches the parent's hash
+		CTObjectRef parent1 = CTJSONParse(allocator, "{\"a\":{\"b\":1}}", 0, NULL), parent2 = CTJSONParse(allocator, "{\"a\":{\"b\":1,\"c\":2}}", 0, NULL);
+		CTDictionaryRef held = CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(parent1), "a"));
+		assert(!CTObjectCompare(parent1, parent2));
+		CTDictionaryAddEntry2(held, CTStringCreate(allocator, "c"), CTObjectWithLong(allocator, 2));
+		assert(CTObjectCompare(parent1, parent2) && CTObjectHash(parent1) == CTObjectHash(parent2));
+		CTAllocatorRelease(other);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTAllocatorStats before = CTAllocatorGetStats(allocator);
+		CTObjectRef number = CTObjectWithDouble(allocator, 2.5);
+		CTObjectRef string = CTObjectWithCharacters(allocator, "short", 5);
+		CTAllocatorStats after = CTAllocatorGetStats(allocator);
+		assert(after.allocations - before.allocations == 2);
+		assert(CTObjectSize(number) && CTObjectType(number) == CTOBJECT_TYPE_NUMBER && CTNumberDoubleValue(CTObjectValue(number)) == 2.5);
+		assert(CTObjectSize(string) && CTStringIsEqual2(CTObjectValue(string), "short"));
+		CTObjectRef copy = CTObjectCopy(allocator, string);
+		CTStringAppendCharacters(CTObjectMutableValue(string), " no longer fits within the object it was embedded in", CTSTRING_NO_LIMIT);
+		CTStringRemoveCharactersFromEnd(CTObjectMutableValue(copy), 2);
+		assert(CTStringIsEqual2(CTObjectValue(string), "short no longer fits within the object it was embedded in") && CTStringIsEqual2(CTObjectValue(copy), "sho"));
+		CTAllocatorRef other = CTAllocatorCreate();
+		CTObjectRef adopted = CTObjectAdopt(other, string);
+		CTObjectRef compacted = CTObjectCompact(other, number);
+		assert(CTStringIsEqual2(CTObjectValue(adopted), "short no longer fits within the object it was embedded in") && CTObjectCompare(compacted, number));
+		assert(!CTObjectSize(CTObjectWithCharacters(allocator, "a string long enough to need an allocation of its own", 53)));
+		CTObjectRelease(adopted);
+		CTObjectRelease(compacted);
+		CTObjectRelease(copy);
+		CTObjectRelease(number);
+		CTAllocatorRelease(other);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef object = CTJSONParse(allocator, "{'a':[1, 2.5, 'three', null, 1343e380, []], 'b':{'c':'d', 'e':{}}, 'f':'a string long enough to need an allocation of its own'}", CTJSONOptionsSingleQuoteStrings, NULL);
+		CTObjectFootprint footprint = CTObjectGetFootprint(object);
+		CTAllocatorStats stats = CTAllocatorGetStats(allocator);
+		assert(footprint.blocks == stats.live_blocks && footprint.total >= stats.live_bytes && !footprint.shared);
+		assert(footprint.total == footprint.headers + footprint.strings + footprint.array_tables + footprint.array_slack + footprint.dictionary_tables);
+		assert(footprint.strings > strlen("a string long enough to need an allocation of its own") && !footprint.array_slack);
+		assert(CTObjectDeepSize(object) == footprint.total && !CTObjectDeepSize(CTObjectNull()));
+		CTObjectRef copy = CTObjectCopy(allocator, object);
+		assert(CTObjectDeepSize(copy) == footprint.total && CTObjectGetFootprint(copy).shared == footprint.total - CTAllocatorBlockSize(copy));
+		CTArrayAddEntry2(CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(copy), "a")), CTObjectWithDouble(allocator, 0.5));
+		assert(CTObjectDeepSize(copy) > footprint.total && CTObjectGetFootprint(copy).array_slack && CTObjectDeepSize(object) == footprint.total);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTErrorRef error = NULL;
+		CTObjectRef object = CTJSONParse(allocator, "{'a':[1, 2.5, 'three', null, 1343e380, []], 'b':{'c':'d', 'e':{}}, 'f':'ghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyz'}", CTJSONOptionsSingleQuoteStrings, &error);
+		assert(!error);
+		CTAllocatorRef compact_allocator = CTAllocatorCreate();
+		CTObjectRef compact = CTObjectCompact(compact_allocator, object);
+		assert(CTObjectCompare(object, compact));
+		assert(CTAllocatorGetStats(compact_allocator).live_blocks == 1);
+		assert(CTAllocatorGetStats(compact_allocator).objects[CTOBJECT_TYPE_STRING + 1] == CTAllocatorGetStats(allocator).objects[CTOBJECT_TYPE_STRING + 1]);
+		CTAllocatorRelease(allocator);
+		
+		CTStringRef f = CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(compact), "f"));
+		assert(!((uintptr_t)CTStringUTF8String(f) & (CTALLOCATOR_SIMD_ALIGNMENT - 1)));
+		CTStringAppendCharacters(f, "!", CTSTRING_NO_LIMIT);
+		CTArrayRef a = CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(compact), "a"));
+		CTArrayAddEntry2(a, CTObjectWithNumber(compact_allocator, CTNumberCreateWithLong(compact_allocator, 7)));
+		CTArrayDeleteEntry(a, 0);
+		CTDictionaryAddEntry(CTObjectMutableValue(compact), "g", CTObjectWithString(compact_allocator, CTStringCreate(compact_allocator, "h")));
+		assert(CTStringUTF8String(f)[CTStringLength(f) - 1] == '!' && CTArrayCount(a) == 6);
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(compact_allocator, CTDictionaryObjectForKey(CTObjectValue(compact), "b"), 0)), "{\"c\":\"d\",\"e\":{}}"));
+		CTObjectRelease(compact);
+		assert(!CTAllocatorGetStats(compact_allocator).objects[CTOBJECT_TYPE_DICTIONARY + 1]);
+		CTAllocatorRelease(compact_allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef object = CTJSONParse(allocator, "[true, false, null, 5, -3, 1023, 1024, -129, {'a':0}]", CTJSONOptionsSingleQuoteStrings, NULL);
+		CTAllocatorStats stats = CTAllocatorGetStats(allocator);
+		assert(stats.objects[CTOBJECT_TYPE_NUMBER + 1] == 2 && !stats.objects[CTOBJECT_TYPE_NULL + 1]);
+		CTArrayRef array = CTObjectValue(object);
+		assert(CTArrayEntry(array, 0) == CTObjectWithBool(1) && CTArrayEntry(array, 3) == CTObjectWithLong(allocator, 5) && CTArrayEntry(array, 2) == CTObjectNull());
+		assert(CTNumberLongValue(CTObjectValue(CTArrayEntry(array, 4))) == -3 && CTNumberLongValue(CTObjectValue(CTArrayEntry(array, 7))) == -129);
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(allocator, object, 0)), "[1,0,null,5,-3,1023,1024,-129,{\"a\":0}]"));
+		CTObjectRef copy = CTObjectCopy(allocator, object);
+		assert(CTObjectCompare(object, copy) && CTArrayEntry(CTObjectValue(copy), 5) == CTArrayEntry(array, 5));
+		CTNumberRef number = CTNumberCopy(allocator, CTObjectValue(CTArrayEntry(array, 5)));
+		CTNumberSetLongValue(number, 7);
+		assert(CTNumberLongValue(CTObjectValue(CTArrayEntry(array, 5))) == 1023);
+		CTObjectRelease(copy);
+		CTAllocatorRef arena = CTAllocatorCreateArena();
+		CTObjectRelease(CTObjectAdopt(arena, object));
+		assert(!CTAllocatorGetStats(allocator).objects[CTOBJECT_TYPE_NUMBER + 1]);
+		CTAllocatorRelease(arena);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef request = CTAllocatorCreate();
+		CTAllocatorRef cache = CTAllocatorCreate();
+		const char * JSON = "{'a':[1, 2.5, 'three', null, 1343e380, []], 'b':{'c':'d', 'e':{}}, 'f':'ghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyz'}";
+		CTObjectRef object = CTJSONParse(request, JSON, CTJSONOptionsSingleQuoteStrings, NULL);
+		const char * f = CTStringUTF8String(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(object), "f")));
+		object = CTObjectAdopt(cache, object);
+		assert(CTAllocatorGetStats(cache).objects[CTOBJECT_TYPE_STRING + 1] == 3 && !CTAllocatorGetStats(request).objects[CTOBJECT_TYPE_STRING + 1]);
+		CTAllocatorRelease(request);
+		assert(CTStringUTF8String(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(object), "f"))) == f);
+		CTArrayAddEntry2(CTObjectMutableValue(CTDictionaryObjectForKey(CTObjectMutableValue(object), "a")), CTObjectWithNull(cache, CTNullCreate()));
+		CTAllocatorRef check = CTAllocatorCreateArena();
+		assert(CTObjectCompare(object, CTJSONParse(check, "{'a':[1, 2.5, 'three', null, 1343e380, [], null], 'b':{'c':'d', 'e':{}}, 'f':'ghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyzghijklmnopqrstuvwxyz'}", CTJSONOptionsSingleQuoteStrings, NULL)));
+		object = CTObjectAdopt(check, object);
+		CTAllocatorRelease(cache);
+		assert(CTArrayCount(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(object), "a"))) == 7);
+		CTAllocatorRelease(check);
+	}
+	{
+		// Nesting far deeper than the C stack could take is parsed, copied, compared, serialised and released
+		const uint64_t depth = 200000;
+		char * deep = malloc(depth * 2 + 1);
+		memset(deep, '[', depth);
+		memset(deep + depth, ']', depth);
+		deep[depth * 2] = 0;
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTAllocatorRef other = CTAllocatorCreate();
+		CTObjectRef object = CTJSONParse(allocator, deep, 0, NULL);
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(allocator, object, 0)), deep));
+		CTObjectRef copy = CTObjectCopy(other, object);
+		assert(CTObjectCompare(object, copy) && CTObjectHash(object) == CTObjectHash(copy));
+		assert(CTObjectGetFootprint(copy).blocks == CTAllocatorGetStats(other).live_blocks);
+		CTObjectFreeze(copy);
+		assert(CTObjectIsFrozen(copy));
+		CTObjectRelease(copy);
+		assert(!CTAllocatorGetStats(other).live_blocks);
+		CTObjectRelease(object);
+		memset(deep, 'l', depth);
+		memset(deep + depth, 'e', depth);
+		CTErrorRef error = NULL;
+		object = CTBencodeParse(allocator, deep, &error);
+		assert(!error && !strcmp(CTStringUTF8String(CTBencodeSerialise(allocator, object, NULL)), deep));
+		const char * bencoded = "d1:ai10e1:bli-5ei100e10:0123456789ee";
+		assert(!strcmp(CTStringUTF8String(CTBencodeSerialise(allocator, CTBencodeParse(allocator, bencoded, NULL), NULL)), bencoded));
+		free(deep);
+		CTAllocatorRelease(other);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef builder = CTAllocatorCreateArena();
+		CTStringRef JSON = CTStringCreate(builder, "[");
+		for (int i = 0; i < 0x100; ++i)
+		{
+			char record[0x80];
+			sprintf(record, "%s{'i':%d,'t':[6,8],'g':1,'sc':[0,204],'s':{'bs':'','og':'x'}}", i ? "," : "", i % 0x10);
+			CTStringAppendCharacters(JSON, record, CTSTRING_NO_LIMIT);
+		}
+		CTStringAppendCharacter(JSON, ']');
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef object = CTJSONParse(allocator, CTStringUTF8String(JSON), CTJSONOptionsSingleQuoteStrings, NULL);
+		const uint64_t parsed = CTAllocatorGetStats(allocator).live_bytes;
+		CTObjectInternTableRef table = CTObjectInternTableCreate(allocator);
+		object = CTObjectIntern(table, object);
+		CTObjectInternStats stats = CTObjectInternTableGetStats(table);
+		// Only the sixteen distinct records, the two arrays, two strings and dictionary they repeat, the outer array and the seven keys are left, small numbers are shared already
+		assert(stats.objects == 22 && stats.keys == 7 && stats.hit_rate > 0.9);
+		assert(CTAllocatorGetStats(allocator).live_bytes * 4 < parsed && CTObjectIsFrozen(object));
+		CTArrayRef records = CTObjectValue(object);
+		assert(CTArrayEntry(records, 0) == CTArrayEntry(records, 0x10) && CTArrayEntry(records, 0) != CTArrayEntry(records, 1));
+		assert(CTDictionaryObjectForKey(CTObjectValue(CTArrayEntry(records, 0)), "t") == CTDictionaryObjectForKey(CTObjectValue(CTArrayEntry(records, 1)), "t"));
+		assert(CTObjectCompare(object, CTJSONParse(builder, CTStringUTF8String(JSON), CTJSONOptionsSingleQuoteStrings, NULL)));
+		CTObjectRef copy = CTObjectIntern(table, CTJSONParse(allocator, CTStringUTF8String(JSON), CTJSONOptionsSingleQuoteStrings, NULL));
+		assert(copy == object);
+		CTObjectRelease(copy);
+		CTObjectInternTableRelease(table);
+		assert(CTObjectCompare(object, CTJSONParse(builder, CTStringUTF8String(JSON), CTJSONOptionsSingleQuoteStrings, NULL)));
+		CTObjectRelease(object);
+		assert(!CTAllocatorGetStats(allocator).live_blocks);
+		CTAllocatorRelease(allocator);
+		CTAllocatorRelease(builder);
+	}
+	{
+		// Reordered arrays and strings with equal hashes ("Ab" and "BA" both hash to 2243) are equal to CTObjectCompare, but never to the table
+		CTAllocatorRef builder = CTAllocatorCreateArena();
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		const char * JSON = "[[6,8],[8,6],\"Ab\",\"BA\",{\"Ab\":1},{\"BA\":1}]";
+		CTObjectInternTableRef table = CTObjectInternTableCreate(allocator);
+		CTObjectRef object = CTObjectIntern(table, CTJSONParse(allocator, JSON, 0, NULL));
+		CTArrayRef elements = CTObjectValue(object);
+		assert(CTObjectCompare(CTArrayEntry(elements, 0), CTArrayEntry(elements, 1)) && !CTObjectCompareExact(CTArrayEntry(elements, 0), CTArrayEntry(elements, 1)));
+		assert(CTArrayEntry(elements, 0) != CTArrayEntry(elements, 1) && CTArrayEntry(elements, 2) != CTArrayEntry(elements, 3) && CTArrayEntry(elements, 4) != CTArrayEntry(elements, 5));
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(builder, object, 0)), JSON));
+		CTObjectRef again = CTObjectIntern(table, CTJSONParse(allocator, JSON, 0, NULL));
+		assert(again == object && CTObjectCompareExact(again, CTJSONParse(builder, JSON, 0, NULL)));
+		CTObjectRelease(again);
+		CTObjectInternTableRelease(table);
+		CTObjectRelease(object);
+		assert(!CTAllocatorGetStats(allocator).live_blocks);
+		CTAllocatorRelease(allocator);
+		CTAllocatorRelease(builder);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef object1 = CTJSONParse(allocator, "{'a':[1,2,3,4],'b':{'c':'d','e/f':{'g':[5]}},'h':'i','j~':null}", CTJSONOptionsSingleQuoteStrings, NULL);
+		CTObjectRef object2 = CTJSONParse(allocator, "{'a':[1,7,2,3,4],'b':{'c':'d','e/f':{'g':[6]}},'k':true,'j~':false}", CTJSONOptionsSingleQuoteStrings, NULL);
+		CTObjectRef original = CTObjectCopy(allocator, object1);
+		CTObjectRef patch = CTObjectDiff(allocator, object1, object2);
+		// Adding 'k', replacing 'j~', removing 'h', the 5 in the nested array and inserting the 7
+		CTArrayRef operations = CTObjectValue(patch);
+		assert(CTArrayCount(operations) == 5);
+		assert(CTStringIsEqual2(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(CTArrayEntry(operations, 1)), "path")), "/j~0"));
+		assert(CTStringIsEqual2(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(CTArrayEntry(operations, 3)), "path")), "/b/e~1f/g/0"));
+		assert(CTStringIsEqual2(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(CTArrayEntry(operations, 4)), "path")), "/a/1"));
+		CTErrorRef error = NULL;
+		object1 = CTObjectApplyPatch(object1, patch, &error);
+		assert(!error && CTObjectCompare(object1, object2));
+		assert(!CTObjectCompare(original, object2) && CTArrayCount(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(original), "a"))) == 4);
+		CTObjectRelease(patch);
+		patch = CTObjectDiff(allocator, object1, object2);
+		assert(!CTArrayCount(CTObjectValue(patch)));
+		CTObjectRelease(patch);
+		CTObjectRef replacement = CTJSONParse(allocator, "[1000]", 0, NULL);
+		patch = CTObjectDiff(allocator, original, replacement);
+		original = CTObjectApplyPatch(original, patch, NULL);
+		assert(CTArrayCount(CTObjectValue(patch)) == 1 && CTObjectCompare(original, replacement));
+		CTObjectRelease(replacement);
+		CTObjectRelease(patch);
+		patch = CTJSONParse(allocator, "[{'op':'remove','path':'/b/x/y'}]", CTJSONOptionsSingleQuoteStrings, NULL);
+		object1 = CTObjectApplyPatch(object1, patch, &error);
+		assert(error && error->code == CTJSON_PATCH_PATH_NOT_FOUND && CTObjectCompare(object1, object2));
+		CTErrorRelease(error);
+		error = NULL;
+		CTObjectRelease(patch);
+		patch = CTJSONParse(allocator, "[{'op':'add','path':'/a/-','value':8},{'op':'move','path':'/k','from':'/a'}]", CTJSONOptionsSingleQuoteStrings, NULL);
+		object1 = CTObjectApplyPatch(object1, patch, &error);
+		assert(error && error->code == CTJSON_PATCH_INVALID_OPERATION && CTArrayCount(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(object1), "a"))) == 6);
+		CTErrorRelease(error);
+		CTObjectRelease(patch);
+		CTObjectRelease(original);
+		CTObjectRelease(object2);
+		CTObjectRelease(object1);
+		assert(!CTAllocatorGetStats(allocator).live_blocks);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		// Hashes that match are only a hint, reordered elements and colliding strings are still replaced
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef object1 = CTJSONParse(allocator, "[1,[6,8],\"Ab\",{\"Ab\":1}]", 0, NULL);
+		CTObjectRef object2 = CTJSONParse(allocator, "[1,[8,6],\"BA\",{\"BA\":1}]", 0, NULL);
+		CTObjectRef patch = CTObjectDiff(allocator, object1, object2);
+		// Replacing both elements of the nested array and the string, adding 'BA' and removing 'Ab'
+		assert(CTArrayCount(CTObjectValue(patch)) == 5);
+		CTErrorRef error = NULL;
+		object1 = CTObjectApplyPatch(object1, patch, &error);
+		assert(!error && CTObjectCompareExact(object1, object2));
+		CTObjectRelease(patch);
+		patch = CTObjectDiff(allocator, object1, object2);
+		assert(!CTArrayCount(CTObjectValue(patch)));
+		CTObjectRelease(patch);
+		// Paths longer than the buffers on the C stack and dictionaries larger than the key tables on it spill onto the heap
+		CTDictionaryRef inner1 = CTDictionaryCreate(allocator), inner2 = CTDictionaryCreate(allocator);
+		for (int i = 0; i < 0x40; ++i)
+		{
+			char key[0x10];
+			sprintf(key, "k%d", i);
+			CTDictionaryAddEntry(inner1, key, CTObjectWithLong(allocator, i));
+			CTDictionaryAddEntry(inner2, key, CTObjectWithLong(allocator, i + (i == 0x3F)));
+		}
+		char long_key[0x500];
+		memset(long_key, '~', sizeof(long_key) - 1);
+		long_key[sizeof(long_key) - 1] = 0;
+		CTDictionaryRef outer1 = CTDictionaryCreate(allocator), outer2 = CTDictionaryCreate(allocator);
+		CTDictionaryAddEntry(outer1, long_key, CTObjectWithDictionary(allocator, inner1));
+		CTDictionaryAddEntry(outer2, long_key, CTObjectWithDictionary(allocator, inner2));
+		CTObjectRef wide1 = CTObjectWithDictionary(allocator, outer1), wide2 = CTObjectWithDictionary(allocator, outer2);
+		patch = CTObjectDiff(allocator, wide1, wide2);
+		assert(CTArrayCount(CTObjectValue(patch)) == 1 && CTStringLength(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(CTArrayEntry(CTObjectValue(patch), 0)), "path"))) == 1 + 2 * 0x4FF + 4);
+		wide1 = CTObjectApplyPatch(wide1, patch, &error);
+		assert(!error && CTObjectCompareExact(wide1, wide2));
+		CTObjectRelease(patch);
+		CTObjectRelease(wide2);
+		CTObjectRelease(wide1);
+		CTObjectRelease(object2);
+		CTObjectRelease(object1);
+		assert(!CTAllocatorGetStats(allocator).live_blocks);
+		CTAllocatorRelease(allocator);
+	}
+}
+
+void CTPathTests()
+{
+	CTAllocatorRef allocator = CTAllocatorCreate();
+	const char * JSON = "{'r':{'ip':'131.203.237.162','d':{'s':{'c':[{'cp':2,'d':[{'i':13,'t':[0]},{'i':17,'t':[0]},{'i':20,'t':[1]}]},{'cp':3,'d':[{'i':1,'t':[0]}]}]}}},'a/b':{'~':'x','0':'zero'}}";
+	CTObjectRef object = CTJSONParse(allocator, JSON, CTJSONOptionsSingleQuoteStrings, NULL);
+	CTPathRef pointer = CTPathCreate(allocator, "/r/d/s/c/0/d/1/i", NULL);
+	CTPathRef JSONPath = CTPathCreate(allocator, "$.r.d.s.c[0].d[1].i", NULL);
+	assert(pointer->count == 8 && !pointer->wildcards && JSONPath->count == 8);
+	assert(CTNumberLongValue(CTObjectValue(CTPathEvaluate(pointer, object))) == 17 && CTPathEvaluate(JSONPath, object) == CTPathEvaluate(pointer, object));
+	CTPathRef escaped = CTPathCreate(allocator, "/a~1b/~0", NULL);
+	assert(CTStringIsEqual2(CTObjectValue(CTPathEvaluate(escaped, object)), "x"));
+	CTPathRelease(escaped);
+	escaped = CTPathCreate(allocator, "$['a/b']['0']", NULL);
+	assert(CTStringIsEqual2(CTObjectValue(CTPathEvaluate(escaped, object)), "zero"));
+	CTPathRelease(escaped);
+	// Segments of JSON Pointers that are numbers name dictionary keys as well
+	escaped = CTPathCreate(allocator, "/a~1b/0", NULL);
+	assert(CTStringIsEqual2(CTObjectValue(CTPathEvaluate(escaped, object)), "zero"));
+	CTPathRelease(escaped);
+	CTPathRef missing = CTPathCreate(allocator, "/r/d/s/c/5/d", NULL);
+	assert(!CTPathEvaluate(missing, object));
+	CTPathRelease(missing);
+	missing = CTPathCreate(allocator, "$.r.ip.x", NULL);
+	assert(!CTPathEvaluate(missing, object));
+	CTPathRelease(missing);
+	CTPathRef root = CTPathCreate(allocator, "", NULL);
+	assert(CTPathEvaluate(root, object) == object);
+	CTPathRelease(root);
+	const char * wildcards[] = {"/r/d/s/c/*/d/*/i", "$.r.d.s.c[*].d.*.i"};
+	for (int i = 0; i < 2; ++i)
+	{
+		CTPathRef path = CTPathCreate(allocator, wildcards[i], NULL);
+		assert(path->wildcards == 2);
+		const int64_t expected[] = {13, 17, 20, 1};
+		CTPathIterator iterator;
+		CTPathIteratorInit(&iterator, path, object);
+		uint64_t count = 0;
+		for (CTObjectRef found = CTPathIteratorNext(&iterator); found; found = CTPathIteratorNext(&iterator))
+		{
+			assert(count < 4 && CTNumberLongValue(CTObjectValue(found)) == expected[count]);
+			++count;
+		}
+		assert(count == 4 && !CTPathIteratorNext(&iterator));
+		CTPathIteratorRelease(&iterator);
+		assert(CTNumberLongValue(CTObjectValue(CTPathEvaluate(path, object))) == 13);
+		CTPathRelease(path);
+	}
+	// Compiled paths are evaluated against any number of documents
+	CTObjectRef other = CTJSONParse(allocator, "{'r':{'d':{'s':{'c':[{'d':[{'i':5},{'i':6}]}]}}}}", CTJSONOptionsSingleQuoteStrings, NULL);
+	assert(CTNumberLongValue(CTObjectValue(CTPathEvaluate(JSONPath, other))) == 6);
+	CTObjectFreeze(other);
+	assert(CTNumberLongValue(CTObjectValue(CTPathEvaluate(pointer, other))) == 6);
+	CTObjectRelease(other);
+	const char * invalid[] = {"r/d", "$.r.", "$.c[01]", "$.c['d]", "/a~2b", "$r"};
+	for (int i = 0; i < 6; ++i)
+	{
+		CTErrorRef error = NULL;
+		assert(!CTPathCreate(allocator, invalid[i], &error) && error && error->code == CTPATH_SYNTAX_ERROR);
+		CTErrorRelease(error);
+	}
+	CTPathRelease(JSONPath);
+	CTPathRelease(pointer);
+	CTObjectRelease(object);
+	assert(!CTAllocatorGetStats(allocator).live_blocks);
+	CTAllocatorRelease(allocator);
+}
+
+void CTParseCacheTests()
+{
+	CTAllocatorRef allocator = CTAllocatorCreate();
+	CTParseCacheRef cache = CTParseCacheCreate(allocator, 0x10000);
+	const char * heartbeat = "{\"type\":\"heartbeat\",\"seq\":[1,2,3]}";
+	CTObjectRef first = CTJSONParseCached(cache, heartbeat, 0, NULL);
+	CTObjectRef second = CTJSONParseCached(cache, heartbeat, 0, NULL);
+	assert(first == second && CTObjectIsFrozen(first));
+	assert(CTStringIsEqual2(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(first), "type")), "heartbeat"));
+	CTParseCacheStats stats = CTParseCacheGetStats(cache);
+	assert(stats.hits == 1 && stats.misses == 1 && stats.entries == 1 && stats.bytes >= CTObjectDeepSize(first));
+	// The same bytes parsed with other options, or as bencode, are cached separately
+	CTObjectRef plain = CTJSONParseCached(cache, "[1,2,3]", 0, NULL);
+	CTObjectRef quoted = CTJSONParseCached(cache, "[1,2,3]", CTJSONOptionsSingleQuoteStrings, NULL);
+	assert(quoted != plain && CTObjectCompare(quoted, plain));
+	CTObjectRelease(plain);
+	CTObjectRef bencoded = CTBencodeParseCached(cache, "d4:type9:heartbeate", NULL);
+	CTObjectRef again = CTBencodeParseCached(cache, "d4:type9:heartbeate", NULL);
+	assert(bencoded == again);
+	CTObjectRelease(again);
+	CTObjectRelease(bencoded);
+	stats = CTParseCacheGetStats(cache);
+	assert(stats.hits == 2 && stats.misses == 4 && stats.entries == 4);
+	// Input that fails to parse is never cached
+	for (int i = 0; i < 2; ++i)
+	{
+		CTErrorRef error = NULL;
+		CTObjectRef invalid = CTJSONParseCached(cache, "[1, nope]", 0, &error);
+		assert(error && !CTObjectIsFrozen(invalid));
+		CTErrorRelease(error);
+		CTObjectRelease(invalid);
+	}
+	stats = CTParseCacheGetStats(cache);
+	assert(stats.misses == 6 && stats.entries == 4);
+	CTObjectRelease(quoted);
+	CTObjectRelease(second);
+	CTParseCacheRelease(cache);
+	// Documents outlive the cache they came from
+	assert(CTStringIsEqual2(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(first), "type")), "heartbeat"));
+	CTObjectRelease(first);
+	assert(!CTAllocatorGetStats(allocator).live_blocks);
+	
+	// The least recently used document goes first once the budget is exceeded
+	cache = CTParseCacheCreate(allocator, 0x10000);
+	CTObjectRelease(CTJSONParseCached(cache, "{\"id\":1001}", 0, NULL));
+	const uint64_t bytes = CTParseCacheGetStats(cache).bytes;
+	CTParseCacheRelease(cache);
+	cache = CTParseCacheCreate(allocator, bytes * 5 / 2);
+	CTObjectRelease(CTJSONParseCached(cache, "{\"id\":1001}", 0, NULL));
+	CTObjectRelease(CTJSONParseCached(cache, "{\"id\":1002}", 0, NULL));
+	CTObjectRelease(CTJSONParseCached(cache, "{\"id\":1001}", 0, NULL));
+	CTObjectRef kept = CTJSONParseCached(cache, "{\"id\":1003}", 0, NULL);
+	stats = CTParseCacheGetStats(cache);
+	assert(stats.evictions == 1 && stats.entries == 2 && stats.bytes <= bytes * 5 / 2);
+	CTObjectRelease(CTJSONParseCached(cache, "{\"id\":1001}", 0, NULL));
+	CTObjectRelease(CTJSONParseCached(cache, "{\"id\":1002}", 0, NULL));
+	stats = CTParseCacheGetStats(cache);
+	assert(stats.hits == 2 && stats.misses == 4 && stats.evictions == 2);
+	// Documents larger than the whole budget are returned without being cached
+	CTObjectRef large = CTJSONParseCached(cache, "{\"id\":1004,\"tags\":[\"a\",\"b\",\"c\",\"d\",\"e\",\"f\",\"g\",\"h\",\"i\",\"j\",\"k\",\"l\",\"m\",\"n\",\"o\",\"p\"]}", 0, NULL);
+	assert(CTObjectIsFrozen(large) && CTParseCacheGetStats(cache).entries == 2);
+	CTObjectRelease(large);
+	CTParseCacheRelease(cache);
+	CTObjectRelease(kept);
+	assert(!CTAllocatorGetStats(allocator).live_blocks);
+	CTAllocatorRelease(allocator);
+}
+
+typedef struct
+{
+	int64_t live;
+	char * memory;
+	uint64_t used;
+	uint64_t size;
+} CTTestBackendContext;
+
+void * CTTestMallocAllocate(void * context, uint64_t size)
+{
+	++((CTTestBackendContext *)context)->live;
+	return malloc(size);
+}
+
+void * CTTestMallocReallocate(void * context, void * ptr, uint64_t old_size, uint64_t size)
+{
+	return realloc(ptr, size);
+}
+
+void CTTestMallocDeallocate(void * context, void * ptr, uint64_t size)
+{
+	--((CTTestBackendContext *)context)->live;
+	free(ptr);
+}
+
+void * CTTestBumpAllocate(void * context, uint64_t size)
+{
+	CTTestBackendContext * bump = context;
+	size = (size + 0xF) & ~0xFULL;
+	assert(bump->used + size <= bump->size);
+	bump->used += size;
+	return bump->memory + bump->used - size;
+}
+
+void * CTTestBumpReallocate(void * context, void * ptr, uint64_t old_size, uint64_t size)
+{
+	void * new_ptr = CTTestBumpAllocate(context, size);
+	memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+	return new_ptr;
+}
+
+void CTTestBumpDeallocate(void * context, void * ptr, uint64_t size)
+{
+}
+
+void CTAllocatorTests()
+{
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTAllocatorRef arena = CTAllocatorCreateArena();
+		const char * JSON = "{'a':[1, 2.5, 'three', null, true], 'b':{'c':'d'}, 'e':1343e380}";
+		CTErrorRef error = NULL;
+		CTObjectRef object1 = CTJSONParse(allocator, JSON, CTJSONOptionsSingleQuoteStrings, &error);
+		assert(!error);
+		CTObjectRef object2 = CTJSONParse(arena, JSON, CTJSONOptionsSingleQuoteStrings, &error);
+		assert(!error);
+		assert(CTObjectCompare(object1, object2));
+		assert(strcmp(CTStringUTF8String(CTJSONSerialise(allocator, object1, 0)), CTStringUTF8String(CTJSONSerialise(arena, object2, 0))) == 0);
+		
+		CTStringRef string = CTStringCreate(arena, "arena");
+		for (int i = 0; i < 0x1000; ++i)
+		{
+			CTStringAppendCharacter(string, 'a' + i % 26);
+		}
+		assert(CTStringLength(string) == 0x1005);
+		CTStringRemoveCharactersFromStart(string, 5);
+		assert(CTStringUTF8String(string)[0] == 'a');
+		char * large = CTAllocatorAllocate(arena, 0x100000);
+		memset(large, 0xFF, 0x100000);
+		
+		CTObjectRelease(object2);
+		CTAllocatorEmpty(arena);
+		object2 = CTJSONParse(arena, JSON, CTJSONOptionsSingleQuoteStrings, &error);
+		assert(CTObjectCompare(object1, object2));
+		CTAllocatorRelease(arena);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTObjectRef number = CTObjectWithNumber(allocator, CTNumberCreateWithLong(allocator, 1));
+		CTNumberRef value = CTObjectValue(number);
+		CTObjectRelease(number);
+		CTObjectRef recycled = CTObjectWithNumber(allocator, CTNumberCreateWithLong(allocator, 2));
+		assert(CTObjectValue(recycled) == value);
+		assert(CTNumberLongValue(CTObjectValue(recycled)) == 2);
+		
+		CTStringRef string = CTStringCreate(allocator, "");
+		for (int i = 0; i < 0x100; ++i)
+		{
+			CTStringAppendCharacter(string, 'a' + i % 26);
+		}
+		assert(CTStringLength(string) == 0x100 && CTStringUTF8String(string)[0x40] == 'm');
+		CTAllocatorEmpty(allocator);
+		assert(CTNumberLongValue(CTNumberCreateWithLong(allocator, 3)) == 3);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTErrorRef error = NULL;
+		CTObjectRef object = CTJSONParse(allocator, "{'a':[1, 2000, 'three'], 'b':'c'}", CTJSONOptionsSingleQuoteStrings, &error);
+		assert(!error);
+		CTAllocatorStats stats = CTAllocatorGetStats(allocator);
+		assert(stats.live_blocks == stats.allocations - stats.deallocations);
+		assert(stats.live_bytes && stats.peak_bytes >= stats.live_bytes);
+		assert(stats.objects[CTOBJECT_TYPE_DICTIONARY + 1] == 1);
+		assert(stats.objects[CTOBJECT_TYPE_STRING + 1] == 2);
+		// 1 is a shared object and not counted
+		assert(stats.objects[CTOBJECT_TYPE_NUMBER + 1] == 1);
+		uint64_t histogram_blocks = 0;
+		for (int i = 0; i < CTALLOCATOR_HISTOGRAM_BUCKETS; ++i)
+		{
+			histogram_blocks += stats.histogram[i];
+		}
+		assert(histogram_blocks == stats.live_blocks);
+		
+		CTObjectRelease(object);
+		stats = CTAllocatorGetStats(allocator);
+		assert(stats.objects[CTOBJECT_TYPE_STRING + 1] == 0);
+		CTAllocatorEmpty(allocator);
+		stats = CTAllocatorGetStats(allocator);
+		assert(stats.live_blocks == 0 && stats.live_bytes == 0 && stats.peak_bytes);
+		CTAllocatorRelease(allocator);
+	}
+	CTAllocatorRef allocators[] = {CTAllocatorCreate(), CTAllocatorCreateArena()};
+	for (int i = 0; i < 2; ++i)
+	{
+		CTAllocatorRef allocator = allocators[i];
+		char * small = CTAllocatorAllocateAligned(allocator, 24, 64, CTAllocatorOptionsUninitialised);
+		char * large = CTAllocatorAllocateAligned(allocator, 0x1000, 32, 0);
+		assert(!((uintptr_t)small & 63) && !((uintptr_t)large & 31) && !large[0xFFF]);
+		memset(large, 'x', 0x1000);
+		for (uint64_t size = 0x2000; size <= 0x20000; size *= 2)
+		{
+			large = CTAllocatorReallocate(allocator, large, size);
+			assert(!((uintptr_t)large & 31) && large[0] == 'x' && large[0xFFF] == 'x');
+		}
+		small = CTAllocatorReallocateAligned(allocator, CTAllocatorAllocate(allocator, 16), 0x200, 64, 0);
+		assert(!((uintptr_t)small & 63));
+		CTAllocatorDeallocate(allocator, small);
+		CTAllocatorDeallocate(allocator, large);
+		CTAllocatorRelease(allocator);
+	}
+	CTAllocatorRef scoped[] = {CTAllocatorCreate(), CTAllocatorCreateArena(), CTAllocatorCreateShared()};
+	for (int i = 0; i < 3; ++i)
+	{
+		CTAllocatorRef allocator = scoped[i];
+		CTStringRef outer = CTStringCreate(allocator, "outer");
+		uint64_t live_blocks = CTAllocatorGetStats(allocator).live_blocks;
+		CTAllocatorScope scope, inner;
+		CTAllocatorMark(allocator, &scope);
+		CTStringRef temporary = CTStringCreate(allocator, "temporary");
+		CTAllocatorMark(allocator, &inner);
+		for (int j = 0; j < 0x100; ++j)
+		{
+			CTStringAppendCharacter(outer, 'x');
+			CTStringAppendCharacter(temporary, 'y');
+			CTAllocatorDeallocate(allocator, CTAllocatorAllocate(allocator, j));
+			CTAllocatorAllocate(allocator, j);
+		}
+		CTAllocatorRewind(allocator, &inner);
+		assert(CTStringLength(temporary) == 0x109 && CTStringUTF8String(temporary)[0x108] == 'y');
+		CTAllocatorRewind(allocator, &scope);
+		assert(CTStringLength(outer) == 0x105 && CTStringUTF8String(outer)[0x104] == 'x');
+		assert(CTAllocatorGetStats(allocator).live_blocks == live_blocks);
+		
+		CTObjectRef object = CTJSONParse(allocator, "[1.5e3, \"a'b\", {\"c\":-20}]", 0, NULL);
+		CTAllocatorMark(allocator, &scope);
+		assert(!strcmp(CTStringUTF8String(CTJSONSerialise(allocator, object, CTJSONOptionsSingleQuoteStrings)), "[1500,'a\\'b',{'c':-20}]"));
+		CTAllocatorRewind(allocator, &scope);
+		assert(CTNumberDoubleValue(CTObjectValue(CTArrayObjectAtIndex(CTObjectValue(object), 0))) == 1500);
+		assert(CTNumberLongValue(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(CTArrayObjectAtIndex(CTObjectValue(object), 2)), "c"))) == -20);
+		CTAllocatorMark(allocator, &scope);
+		CTAllocatorEmpty(allocator);
+		CTAllocatorRewind(allocator, &scope);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTStringRef string = CTStringCreate(allocator, "");
+		char * block = CTAllocatorAllocateAligned(allocator, 0x3FFF0, 64, 0);
+		for (int i = 0; i < 0x80000; ++i)
+		{
+			CTStringAppendCharacter(string, 'a' + i % 26);
+		}
+		block = CTAllocatorReallocate(allocator, block, 0x100000);
+		assert(!((uintptr_t)block & 63) && !block[0x3FFEF]);
+		assert(CTStringLength(string) == 0x80000 && CTStringUTF8String(string)[0x7FFFF] == 'a' + 0x7FFFF % 26);
+		CTAllocatorEmpty(allocator);
+		assert(CTAllocatorTrim(allocator) > 0 && CTAllocatorTrim(allocator) == 0);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTTestBackendContext context = {0};
+		CTAllocatorBackend backend = {CTTestMallocAllocate, CTTestMallocReallocate, CTTestMallocDeallocate, &context};
+		CTAllocatorRef allocator = CTAllocatorCreateWithBackend(&backend);
+		CTObjectRef object = CTJSONParse(allocator, "{'a':[1, 2, 'three'], 'b':'c'}", CTJSONOptionsSingleQuoteStrings, NULL);
+		char * block = CTAllocatorReallocate(allocator, CTAllocatorAllocate(allocator, 0x100000), 0x200000);
+		block[0x1FFFFF] = 1;
+		assert(context.live > 0 && CTArrayCount(CTObjectValue(CTDictionaryObjectForKey(CTObjectValue(object), "a"))) == 3);
+		CTAllocatorEmpty(allocator);
+		CTAllocatorTrim(allocator);
+		assert(context.live == 0);
+		CTAllocatorRelease(allocator);
+	}
+	{
+		CTTestBackendContext context = {0};
+		CTAllocatorBackend backend = {CTTestMallocAllocate, CTTestMallocReallocate, CTTestMallocDeallocate, &context};
+		for (int i = 0; i < 0x10; ++i)
+		{
+			CTAllocatorRef allocator = CTAllocatorCreateWithBackend(&backend);
+			CTJSONParse(allocator, "{'a':[1, 2, 'three'], 'b':'c'}", CTJSONOptionsSingleQuoteStrings, NULL);
+			CTAllocatorReleaseDeferred(allocator);
+		}
+		CTAllocatorReclaimWait();
+		assert(context.live == 0);
+	}
+#ifdef CTALLOCATOR_PROFILE
+	{
+		CTAllocatorProfileStart(1);
+		CTAllocatorRef allocator = CTAllocatorCreate();
+		CTStringRef string = CTStringCreate(allocator, "");
+		for (int i = 0; i < 0x100; ++i)
+		{
+			CTStringAppendCharacter(string, 'a');
+		}
+		CTAllocatorProfileStart(0);
+		FILE * file = tmpfile();
+		CTAllocatorProfileWrite(file, CTALLOCATOR_PROFILE_FORMAT_COLLAPSED);
+		assert(ftell(file) > 0);
+		fclose(file);
+		CTAllocatorProfileReset();
+		CTAllocatorRelease(allocator);
+	}
+#endif
+}
+
+void * CTAllocatorThreadWork(void * allocator)
+{
+	for (int i = 0; i < 0x100; ++i)
+	{
+		CTArrayRef array = CTArrayCreate(allocator);
+		for (int j = 0; j < 0x100; ++j)
+		{
+			CTArrayAddEntry2(array, CTObjectWithNumber(allocator, CTNumberCreateWithLong(allocator, j)));
+		}
+		assert(CTNumberLongValue(CTObjectValue(CTArrayObjectAtIndex(array, 0xFF))) == 0xFF);
+		CTArrayRelease(array);
+	}
+	return NULL;
+}
+
+void CTAllocatorSharedTests()
+{
+	CTAllocatorRef allocator = CTAllocatorCreateShared();
+	pthread_t threads[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		pthread_create(&threads[i], NULL, CTAllocatorThreadWork, allocator);
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	CTAllocatorStats stats = CTAllocatorGetStats(allocator);
+	assert(stats.allocations == stats.deallocations + stats.live_blocks);
+	assert(stats.objects[CTOBJECT_TYPE_NUMBER + 1] == 0);
+	CTAllocatorRelease(allocator);
+}
+
+void * CTAllocatorBenchmarkWork(void * allocator)
+{
+	void * blocks[0x40];
+	for (int i = 0; i < 0x4000; ++i)
+	{
+		for (int j = 0; j < 0x40; ++j)
+		{
+			blocks[j] = CTAllocatorAllocate(allocator, 0x10 + (j & 0x1F));
+		}
+		for (int j = 0; j < 0x40; ++j)
+		{
+			CTAllocatorDeallocate(allocator, blocks[j]);
+		}
+	}
+	return NULL;
+}
+
+void CTAllocatorBenchmark()
+{
+	for (int count = 1; count <= 8; count *= 2)
+	{
+		CTAllocatorRef allocator = CTAllocatorCreateShared();
+		pthread_t threads[count];
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < count; ++i)
+		{
+			pthread_create(&threads[i], NULL, CTAllocatorBenchmarkWork, allocator);
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			pthread_join(threads[i], NULL);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		printf("CTAllocatorCreateShared, %i threads: %.1f million allocate/deallocate pairs per second\n", count, count * 0x4000 * 0x40 / seconds / 1e6);
+		CTAllocatorRelease(allocator);
+	}
+}
+
+void CTAllocatorBackendBenchmark()
+{
+	CTAllocatorRef builder = CTAllocatorCreate();
+	CTStringRef JSON = CTStringCreate(builder, "[");
+	for (int i = 0; i < 0x400; ++i)
+	{
+		CTStringAppendCharacters(JSON, i ? ",{\"id\":1234,\"name\":\"element\",\"tags\":[1,2.5,\"x\"],\"ok\":true}" : "{\"id\":1234,\"name\":\"element\",\"tags\":[1,2.5,\"x\"],\"ok\":true}", CTSTRING_NO_LIMIT);
+	}
+	CTStringAppendCharacter(JSON, ']');
+	
+	CTTestBackendContext malloc_context = {0};
+	CTTestBackendContext bump_context = {0, malloc(0x4000000), 0, 0x4000000};
+	CTAllocatorBackend backends[] = {
+		{CTTestMallocAllocate, CTTestMallocReallocate, CTTestMallocDeallocate, &malloc_context},
+		{CTTestBumpAllocate, CTTestBumpReallocate, CTTestBumpDeallocate, &bump_context}
+	};
+	const char * names[] = {"CTAllocatorCreate", "CTAllocatorCreateArena", "malloc backend", "bump backend"};
+	for (int i = 0; i < 4; ++i)
+	{
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int j = 0; j < 0x20; ++j)
+		{
+			CTAllocatorRef allocator = i == 0 ? CTAllocatorCreate() : i == 1 ? CTAllocatorCreateArena() : CTAllocatorCreateWithBackend(&backends[i - 2]);
+			CTObjectRelease(CTJSONParse(allocator, CTStringUTF8String(JSON), 0, NULL));
+			CTAllocatorRelease(allocator);
+			bump_context.used = 0;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		printf("%s: %.0f µseconds per parse and release\n", names[i], ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / 0x20);
+	}
+	// Strings this long are tracked individually rather than carved out of chunks, which is what makes releasing a document expensive
+	CTStringRef strings = CTStringCreate(builder, "[");
+	for (int i = 0; i < 0x2000; ++i)
+	{
+		CTStringAppendCharacters(strings, i ? ",\"" : "\"", CTSTRING_NO_LIMIT);
+		for (int j = 0; j < 0x100; ++j)
+		{
+			CTStringAppendCharacter(strings, 'a' + j % 26);
+		}
+		CTStringAppendCharacter(strings, '"');
+	}
+	CTStringAppendCharacter(strings, ']');
+	for (int i = 0; i < 2; ++i)
+	{
+		double release = 0;
+		for (int j = 0; j < 0x20; ++j)
+		{
+			struct timespec start, end;
+			CTAllocatorRef allocator = CTAllocatorCreate();
+			CTJSONParse(allocator, CTStringUTF8String(strings), 0, NULL);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			i ? CTAllocatorReleaseDeferred(allocator) : CTAllocatorRelease(allocator);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			release += (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+		}
+		CTAllocatorReclaimWait();
+		printf("%s: %.1f µseconds per release on the calling thread\n", i ? "CTAllocatorReleaseDeferred" : "CTAllocatorRelease", release / 0x20);
+	}
+	free(bump_context.memory);
+	CTAllocatorRelease(builder);
+}
+
+void CTObjectBenchmark()
+{
+	CTAllocatorRef builder = CTAllocatorCreate();
+	CTStringRef JSON = CTStringCreate(builder, "[");
+	for (int i = 0; i < 0x1000; ++i)
+	{
+		char element[0x80];
+		sprintf(element, "%s{\"id\":%d,\"name\":\"element\",\"tags\":[1,2.5,\"x\"],\"ok\":true}", i ? "," : "", 1234 + i);
+		CTStringAppendCharacters(JSON, element, CTSTRING_NO_LIMIT);
+	}
+	CTStringAppendCharacter(JSON, ']');
+	
+	const char * names[] = {"CTObjectCopy", "CTObjectCompact", "CTObjectAdopt"};
+	for (int i = 0; i < 3; ++i)
+	{
+		double copy = 0, serialise = 0;
+		for (int j = 0; j < 0x10; ++j)
+		{
+			struct timespec start, middle, end;
+			CTAllocatorRef parse_allocator = CTAllocatorCreate();
+			CTAllocatorRef allocator = CTAllocatorCreate();
+			CTObjectRef object = CTJSONParse(parse_allocator, CTStringUTF8String(JSON), 0, NULL);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			CTObjectRef copied = i == 2 ? CTObjectAdopt(allocator, object) : i ? CTObjectCompact(allocator, object) : CTObjectCopy(allocator, object);
+			if (i != 2)
+			{
+				CTObjectRelease(object);
+			}
+			clock_gettime(CLOCK_MONOTONIC, &middle);
+			CTJSONSerialise(parse_allocator, copied, 0);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			copy += (middle.tv_sec - start.tv_sec) * 1e6 + (middle.tv_nsec - start.tv_nsec) / 1e3;
+			serialise += (end.tv_sec - middle.tv_sec) * 1e6 + (end.tv_nsec - middle.tv_nsec) / 1e3;
+			CTAllocatorRelease(allocator);
+			CTAllocatorRelease(parse_allocator);
+		}
+		printf("%s: %.0f µseconds to move the document to another allocator, %.0f µseconds to serialise it afterwards\n", names[i], copy / 0x10, serialise / 0x10);
+	}
+	
+	CTAllocatorRef allocator = CTAllocatorCreate();
+	CTAllocatorRef responses = CTAllocatorCreate();
+	CTObjectRef object = CTJSONParse(allocator, CTStringUTF8String(JSON), 0, NULL);
+	for (int i = 0; i < 2; ++i)
+	{
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int j = 0; j < 0x40; ++j)
+		{
+			CTObjectRelease(CTObjectCopy(i ? responses : allocator, object));
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		printf("CTObjectCopy %s: %.1f µseconds per copy\n", i ? "into another allocator" : "sharing the document", ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / 0x40);
+	}
+	CTObjectRef shuffled = CTJSONParse(responses, CTStringUTF8String(JSON), 0, NULL);
+	CTArrayRef elements = CTObjectValue(shuffled);
+	CTObjectRef first = elements->elements[0];
+	elements->elements[0] = elements->elements[elements->count - 1];
+	elements->elements[elements->count - 1] = first;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert(CTObjectCompare(object, shuffled));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("CTObjectCompare: %.0f µseconds to compare two equal documents\n", (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3);
+	CTArrayDeleteEntry(elements, 0);
+	CTArrayAddEntry2(elements, CTObjectWithLong(responses, 5));
+	CTObjectFreeze(object);
+	CTObjectFreeze(shuffled);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert(!CTObjectCompare(object, shuffled));
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("CTObjectCompare: %.1f µseconds to tell two frozen documents apart by their memoized hashes\n", (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3);
+	CTAllocatorRelease(responses);
+	CTAllocatorRelease(allocator);
+	
+	allocator = CTAllocatorCreate();
+	object = CTJSONParse(allocator, CTStringUTF8String(JSON), 0, NULL);
+	const uint64_t parsed = CTAllocatorGetStats(allocator).live_bytes;
+	CTObjectInternTableRef table = CTObjectInternTableCreate(allocator);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	object = CTObjectIntern(table, object);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	CTObjectInternStats intern_stats = CTObjectInternTableGetStats(table);
+	CTObjectInternTableRelease(table);
+	printf("CTObjectIntern: %.0f µseconds, %.0f%% hit rate, %llu bytes down to %llu\n", (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3, intern_stats.hit_rate * 100, parsed, CTAllocatorGetStats(allocator).live_bytes);
+	CTObjectRelease(object);
+	CTAllocatorRelease(allocator);
+
+	allocator = CTAllocatorCreate();
+	object = CTJSONParse(allocator, CTStringUTF8String(JSON), 0, NULL);
+	CTObjectRef changed = CTJSONParse(allocator, CTStringUTF8String(JSON), 0, NULL);
+	CTDictionaryAddEntry(CTObjectMutableValue(CTArrayEntry(CTObjectMutableValue(changed), 0x800)), "changed", CTObjectWithBool(1));
+	CTObjectHash(object);
+	CTObjectHash(changed);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	CTObjectRef patch = CTObjectDiff(allocator, object, changed);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("CTObjectDiff: %.0f µseconds for %llu operations, %llu bytes of patch instead of %llu\n", (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3, CTArrayCount(CTObjectValue(patch)), CTStringLength(CTJSONSerialise(allocator, patch, 0)), CTStringLength(JSON));
+
+	double sum = 0;
+	struct timespec middle;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (uint64_t i = 0; i < CTArrayCount(CTObjectValue(object)); ++i)
+	{
+		CTObjectRef tags = CTDictionaryObjectForKey(CTObjectValue(CTArrayEntry(CTObjectValue(object), i)), "tags");
+		sum += CTNumberDoubleValue(CTObjectValue(CTArrayEntry(CTObjectValue(tags), 1)));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &middle);
+	CTPathRef path = CTPathCreate(allocator, "/*/tags/1", NULL);
+	CTPathIterator iterator;
+	CTPathIteratorInit(&iterator, path, object);
+	for (CTObjectRef found = CTPathIteratorNext(&iterator); found; found = CTPathIteratorNext(&iterator))
+	{
+		sum -= CTNumberDoubleValue(CTObjectValue(found));
+	}
+	CTPathIteratorRelease(&iterator);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	assert(sum == 0);
+	printf("CTPath: %.0f µseconds to look up every element's tags through CTDictionaryObjectForKey, %.0f µseconds through a compiled path\n", (middle.tv_sec - start.tv_sec) * 1e6 + (middle.tv_nsec - start.tv_nsec) / 1e3, (end.tv_sec - middle.tv_sec) * 1e6 + (end.tv_nsec - middle.tv_nsec) / 1e3);
+	CTPathRelease(path);
+	CTAllocatorRelease(allocator);
+
+	allocator = CTAllocatorCreate();
+	CTParseCacheRef cache = CTParseCacheCreate(allocator, 0x4000000);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	object = CTJSONParseCached(cache, CTStringUTF8String(JSON), 0, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &middle);
+	for (int i = 0; i < 0x40; ++i)
+	{
+		CTObjectRelease(CTJSONParseCached(cache, CTStringUTF8String(JSON), 0, NULL));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	assert(CTParseCacheGetStats(cache).hits == 0x40);
+	printf("CTParseCache: %.0f µseconds to parse and cache the document, %.1f µseconds per hit\n", (middle.tv_sec - start.tv_sec) * 1e6 + (middle.tv_nsec - start.tv_nsec) / 1e3, ((end.tv_sec - middle.tv_sec) * 1e6 + (end.tv_nsec - middle.tv_nsec) / 1e3) / 0x40);
+	CTObjectRelease(object);
+	CTParseCacheRelease(cache);
+	CTAllocatorRelease(allocator);
+
+	for (int count = 1; count <= 4; count *= 2)
+	{
+		CTAllocatorRef shared = CTAllocatorCreateShared();
+		CTObjectHolderRef holder = CTObjectHolderCreate(shared, CTJSONParse(shared, "{\"version\":2000,\"check\":2000}", 0, NULL));
+		pthread_t threads[count];
+		__atomic_store_n(&CTObjectHolderStop, 0, __ATOMIC_RELAXED);
+		struct timespec start, end, pause = {0, 1000000};
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int i = 0; i < count; ++i)
+		{
+			pthread_create(&threads[i], NULL, CTObjectHolderReader, holder);
+		}
+		for (int i = 1; i <= 0x40; ++i)
+		{
+			char JSON[0x40];
+			sprintf(JSON, "{\"version\":%d,\"check\":%d}", 2000 + i, 2000 + i);
+			CTObjectHolderPublish(holder, CTJSONParse(shared, JSON, 0, NULL));
+			nanosleep(&pause, NULL);
+		}
+		__atomic_store_n(&CTObjectHolderStop, 1, __ATOMIC_RELAXED);
+		uint64_t reads = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			void * result;
+			pthread_join(threads[i], &result);
+			reads += (uint64_t)result;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		printf("CTObjectHolder, %d threads: %.1f million reads per second while publishing\n", count, reads / ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3));
+		CTObjectHolderRelease(holder);
+		CTAllocatorRelease(shared);
+	}
+	CTAllocatorRelease(builder);
+}
+
 int main(int argc, const char * argv[])
 {
+	// The heavier suites run once, the timed loop below only covers the baseline tests
+	CTAllocatorTests();
+	CTAllocatorSharedTests();
+	CTObjectTests();
+	CTPathTests();
+	CTParseCacheTests();
 	uint64_t clock_values = 0;
 	uint64_t smoothing_factor = 100;
 	for (uint64_t i = 0; i < smoothing_factor; ++i)
@@ -546,5 +1658,8 @@ int main(int argc, const char * argv[])
 		clock_values += clock() - t;
 	}
 	printf("%.0f µseconds\n", ((clock_values / (double)smoothing_factor) / (double)CLOCKS_PER_SEC) * 1e6);
+	CTAllocatorBenchmark();
+	CTAllocatorBackendBenchmark();
+	CTObjectBenchmark();
     return 0;
 }
\ No newline at end of file
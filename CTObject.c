@@ -10,12 +10,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sched.h>
 #include "CTObject.h"
 #include "CTDictionary.h"
 #include "CTArray.h"
 #include "CTNumber.h"
 #include "CTString.h"
 #include "CTNull.h"
+#include "CTFunctions.h"
 
 inline void * CTObjectValueIfNonNilAndType(CTObjectRef object, CTOBJECT_TYPE type)
 {
@@ -32,103 +34,1495 @@ CTObjectRef CTObjectCreate(CTAllocatorRef restrict alloc, void * ptr, CTOBJECT_T
     object->alloc = alloc;
     object->ptr = ptr;
     object->type = type;
+    CTAllocatorCountObject(alloc, type, 1);
     return object;
 }
 
-CTObjectRef CTObjectCopy(CTAllocatorRef restrict alloc, const CTObject * restrict object)
+CTObjectRef CTObjectCreateWithEmbeddedValue(CTAllocatorRef restrict alloc, uint64_t size, CTOBJECT_TYPE type)
 {
-	switch(object->type)
+	// CTObject is a multiple of 16 bytes, so the value behind it is as aligned as any other allocation
+	CTObjectRef object = CTAllocatorAllocate(alloc, sizeof(CTObject) + size);
+	object->alloc = alloc;
+	object->size = size;
+	object->ptr = object + 1;
+	object->type = type;
+	CTAllocatorCountObject(alloc, type, 1);
+	return object;
+}
+
+static uint64_t * CTObjectReferences(const CTObject * restrict object)
+{
+	switch (object->type)
 	{
 		case CTOBJECT_TYPE_DICTIONARY:
-			return CTObjectWithDictionary(alloc, CTDictionaryCopy(alloc, object->ptr));
+			return &((CTDictionaryRef)object->ptr)->references;
 		case CTOBJECT_TYPE_ARRAY:
-			return CTObjectWithArray(alloc, CTArrayCopy(alloc, object->ptr));
+			return &((CTArrayRef)object->ptr)->references;
+		case CTOBJECT_TYPE_NUMBER:
+			return &((CTNumberRef)object->ptr)->references;
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+			return &((CTLargeNumberRef)object->ptr)->references;
+		case CTOBJECT_TYPE_STRING:
+			return &((CTStringRef)object->ptr)->references;
+		default:
+			return NULL;
+	}
+}
+
+#define CTOBJECT_WALK_INLINE_FRAMES 0x20
+
+typedef struct
+{
+	const CTObject * object;
+	uint64_t index;
+	void * data;
+} CTObjectWalkFrame;
+
+static inline uint8_t CTObjectIsContainer(const CTObject * restrict object)
+{
+	return object->type == CTOBJECT_TYPE_DICTIONARY || object->type == CTOBJECT_TYPE_ARRAY;
+}
+
+void CTObjectWalk(const CTObject * restrict object, CTObjectWalker * walker)
+{
+	CTObjectWalkFrame inline_frames[CTOBJECT_WALK_INLINE_FRAMES];
+	CTObjectWalkFrame * frames = inline_frames;
+	uint64_t capacity = CTOBJECT_WALK_INLINE_FRAMES, depth = 0, index = 0;
+	const CTObject * parent = NULL;
+	while (object)
+	{
+		if (CTObjectIsContainer(object))
+		{
+			if (!walker->enter || walker->enter(walker, object, parent, index))
+			{
+				if (depth == capacity)
+				{
+					frames = stackGrow(frames, inline_frames, &capacity, sizeof(CTObjectWalkFrame));
+				}
+				frames[depth++] = (CTObjectWalkFrame){object, 0, walker->data};
+			}
+		}
+		else if (walker->scalar)
+		{
+			walker->scalar(walker, object, parent, index);
+		}
+		object = NULL;
+		// Move on to the next element of the innermost dictionary or array, leaving those that have none left
+		while (depth && !object)
+		{
+			CTObjectWalkFrame * frame = &frames[depth - 1];
+			const CTObject * container = frame->object;
+			walker->data = frame->data;
+			if (container->type == CTOBJECT_TYPE_DICTIONARY)
+			{
+				const CTDictionary * dict = container->ptr;
+				object = frame->index < dict->count ? dict->elements[frame->index]->value : NULL;
+			}
+			else
+			{
+				const CTArray * array = container->ptr;
+				object = frame->index < array->count ? array->elements[frame->index] : NULL;
+			}
+			if (object)
+			{
+				parent = container;
+				index = frame->index++;
+			}
+			else
+			{
+				--depth;
+				if (walker->leave)
+				{
+					walker->leave(walker, container);
+				}
+			}
+		}
+	}
+	stackRelease(frames, inline_frames);
+}
+
+static CTObjectRef CTObjectShare(CTAllocatorRef restrict alloc, const CTObject * restrict object)
+{
+	if (!object->alloc)
+	{
+		// Shared objects are immutable, so every copy can be the same object
+		return (CTObjectRef)object;
+	}
+	uint64_t * references = CTObjectReferences(object);
+	if (object->alloc == alloc && references && object->size == 0)
+	{
+		// The value is only copied once either object's value is fetched with CTObjectMutableValue, frozen values included, so the copy is never frozen
+		referencesRetain(references);
+		return CTObjectCreate(alloc, object->ptr, object->type);
+	}
+	return NULL;
+}
+
+static CTObjectRef CTObjectCopyScalar(CTAllocatorRef restrict alloc, const CTObject * restrict object)
+{
+	switch(object->type)
+	{
 		case CTOBJECT_TYPE_NUMBER:
-			return CTObjectWithNumber(alloc, CTNumberCopy(alloc, object->ptr));
+		{
+			// Embedded values live and die with their object, so scalars are copied rather than shared
+			const CTNumber * number = object->ptr;
+			CTObjectRef copy = CTObjectCreateWithEmbeddedValue(alloc, sizeof(CTNumber), CTOBJECT_TYPE_NUMBER);
+			CTNumberRef new_number = copy->ptr;
+			*new_number = *number;
+			new_number->alloc = alloc;
+			new_number->references = 0;
+			return copy;
+		}
 		case CTOBJECT_TYPE_LARGE_NUMBER:
 			return CTObjectWithLargeNumber(alloc, CTLargeNumberCopy(alloc, object->ptr));
 		case CTOBJECT_TYPE_STRING:
-			return CTObjectWithString(alloc, CTStringCopy(alloc, object->ptr));
+			return CTObjectWithCharacters(alloc, ((const CTString *)object->ptr)->characters, ((const CTString *)object->ptr)->length);
 		default:
 			return CTObjectWithNull(alloc, CTNullCreate());
 	}
 }
 
-uint8_t CTObjectCompare(const CTObject * restrict object1, const CTObject * restrict object2)
+typedef struct
+{
+	CTAllocatorRef alloc;
+	CTObjectRef copy;
+} CTObjectCopyContext;
+
+static void CTObjectCopyAdd(CTObjectWalker * walker, CTObjectRef copy, const CTObject * parent, uint64_t index)
 {
-	if (object1 == object2)
+	CTObjectCopyContext * context = walker->context;
+	if (!parent)
 	{
-		return 1;
+		context->copy = copy;
 	}
-	
-	if (object1->type == object2->type)
+	else if (parent->type == CTOBJECT_TYPE_DICTIONARY)
 	{
-		switch(object1->type)
+		CTDictionaryRef new_dict = ((CTObjectRef)walker->data)->ptr;
+		CTStringRef key = ((const CTDictionary *)parent->ptr)->elements[index]->key;
+		if (key->alloc == context->alloc)
 		{
-			case CTOBJECT_TYPE_DICTIONARY:
-				return CTDictionaryCompare(object1->ptr, object2->ptr);
-			case CTOBJECT_TYPE_ARRAY:
-				return CTArrayCompare(object1->ptr, object2->ptr);
-			case CTOBJECT_TYPE_NUMBER:
-				return CTNumberCompare(object1->ptr, object2->ptr);
-			case CTOBJECT_TYPE_LARGE_NUMBER:
-				return CTLargeNumberCompare(object1->ptr, object2->ptr);
-			case CTOBJECT_TYPE_STRING:
-				return CTStringIsEqual(object1->ptr, object2->ptr);
-			case CTOBJECT_TYPE_NULL:
-				return 1;
-			case CTOBJECT_NOT_AN_OBJECT:
-				return 0;
+			referencesRetain(&key->references);
 		}
+		else
+		{
+			key = CTStringCopy(context->alloc, key);
+		}
+		CTDictionaryEntry * entry = CTAllocatorAllocate(context->alloc, sizeof(CTDictionaryEntry));
+		entry->key = key;
+		entry->value = copy;
+		new_dict->elements[new_dict->count++] = entry;
+	}
+	else
+	{
+		CTArrayRef new_array = ((CTObjectRef)walker->data)->ptr;
+		new_array->elements[new_array->count++] = copy;
 	}
-	return 0;
 }
 
-inline void * CTObjectValue(const CTObject * restrict object)
+static uint8_t CTObjectCopyEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
 {
-	assert(object);
-	return object->ptr;
+	CTAllocatorRef alloc = ((CTObjectCopyContext *)walker->context)->alloc;
+	CTObjectRef copy = CTObjectShare(alloc, object);
+	if (copy)
+	{
+		CTObjectCopyAdd(walker, copy, parent, index);
+		return 0;
+	}
+	// The copy is added to its parent straight away and filled in as its elements are visited
+	if (object->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		const CTDictionary * dict = object->ptr;
+		CTDictionaryRef new_dict = CTDictionaryCreate(alloc);
+		new_dict->elements = dict->count ? CTAllocatorAllocate(alloc, sizeof(CTDictionaryEntry *) * dict->count) : NULL;
+		copy = CTObjectWithDictionary(alloc, new_dict);
+	}
+	else
+	{
+		const CTArray * array = object->ptr;
+		CTArrayRef new_array = CTArrayCreate(alloc);
+		new_array->elements = array->count ? bufferAllocate(alloc, sizeof(CTObjectRef) * array->count) : NULL;
+		new_array->size = array->count;
+		copy = CTObjectWithArray(alloc, new_array);
+	}
+	CTObjectCopyAdd(walker, copy, parent, index);
+	walker->data = copy;
+	return 1;
 }
 
-inline CTOBJECT_TYPE CTObjectType(const CTObject * restrict object)
+static void CTObjectCopyElement(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
 {
-	assert(object);
-	return object->type;
+	CTAllocatorRef alloc = ((CTObjectCopyContext *)walker->context)->alloc;
+	CTObjectRef copy = CTObjectShare(alloc, object);
+	CTObjectCopyAdd(walker, copy ? copy : CTObjectCopyScalar(alloc, object), parent, index);
 }
 
-inline uint64_t CTObjectSize(const CTObject * restrict object)
+CTObjectRef CTObjectCopy(CTAllocatorRef restrict alloc, const CTObject * restrict object)
 {
-	assert(object);
-	return object->size;
+	CTObjectRef copy = CTObjectShare(alloc, object);
+	if (copy)
+	{
+		return copy;
+	}
+	if (!CTObjectIsContainer(object))
+	{
+		return CTObjectCopyScalar(alloc, object);
+	}
+	CTObjectCopyContext context = {alloc, NULL};
+	CTObjectWalker walker = {CTObjectCopyEnter, NULL, CTObjectCopyElement, &context, NULL};
+	CTObjectWalk(object, &walker);
+	return context.copy;
 }
 
-void CTObjectRelease(CTObjectRef object)
+static uint64_t CTStringCompactSize(const CTString * restrict string)
+{
+	return CTAllocatorRegionBlockSize(sizeof(CTString), 0) + bufferRegionSize(string->length + 1);
+}
+
+static uint64_t CTObjectCompactSize(const CTObject * restrict object)
+{
+	if (!object->alloc)
+	{
+		return 0;
+	}
+	uint64_t size = CTAllocatorRegionBlockSize(sizeof(CTObject), 0);
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+		{
+			const CTDictionary * dict = object->ptr;
+			size += CTAllocatorRegionBlockSize(sizeof(CTDictionary), 0);
+			if (dict->count)
+			{
+				size += CTAllocatorRegionBlockSize(sizeof(CTDictionaryEntry *) * dict->count, 0);
+			}
+			for (uint64_t i = 0; i < dict->count; ++i)
+			{
+				size += CTAllocatorRegionBlockSize(sizeof(CTDictionaryEntry), 0) + CTStringCompactSize(dict->elements[i]->key) + CTObjectCompactSize(dict->elements[i]->value);
+			}
+			break;
+		}
+		case CTOBJECT_TYPE_ARRAY:
+		{
+			const CTArray * array = object->ptr;
+			size += CTAllocatorRegionBlockSize(sizeof(CTArray), 0);
+			if (array->count)
+			{
+				size += bufferRegionSize(sizeof(CTObjectRef) * array->count);
+			}
+			for (uint64_t i = 0; i < array->count; ++i)
+			{
+				size += CTObjectCompactSize(array->elements[i]);
+			}
+			break;
+		}
+		case CTOBJECT_TYPE_STRING:
+			size += CTStringCompactSize(object->ptr);
+			break;
+		case CTOBJECT_TYPE_NUMBER:
+			size = CTAllocatorRegionBlockSize(sizeof(CTObject) + sizeof(CTNumber), 0);
+			break;
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+			size += CTAllocatorRegionBlockSize(sizeof(CTLargeNumber), 0) + CTAllocatorRegionBlockSize(sizeof(CTNumber), 0) * 2;
+			break;
+		case CTOBJECT_TYPE_NULL:
+		case CTOBJECT_NOT_AN_OBJECT:
+			break;
+	}
+	return size;
+}
+
+static CTStringRef CTStringCompactInto(CTAllocatorRef restrict alloc, CTAllocatorRegion * region, const CTString * restrict string)
+{
+	CTStringRef new_string = CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTString), 0);
+	*new_string = *string;
+	new_string->alloc = alloc;
+	new_string->references = 0;
+	new_string->characters = bufferAllocateFromRegion(alloc, region, string->length + 1);
+	memcpy(new_string->characters, string->characters, string->length + 1);
+	return new_string;
+}
+
+static CTNumberRef CTNumberCompactInto(CTAllocatorRef restrict alloc, CTAllocatorRegion * region, const CTNumber * restrict number)
+{
+	CTNumberRef new_number = CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTNumber), 0);
+	*new_number = *number;
+	new_number->alloc = alloc;
+	new_number->references = 0;
+	return new_number;
+}
+
+static CTObjectRef CTObjectCompactInto(CTAllocatorRef restrict alloc, CTAllocatorRegion * region, const CTObject * restrict object)
+{
+	if (!object->alloc)
+	{
+		return (CTObjectRef)object;
+	}
+	const uint64_t embedded = object->type == CTOBJECT_TYPE_NUMBER ? sizeof(CTNumber) : 0;
+	CTObjectRef new_object = CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTObject) + embedded, 0);
+	*new_object = *object;
+	new_object->alloc = alloc;
+	new_object->size = embedded;
+	new_object->frozen_references = 0;
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+		{
+			const CTDictionary * dict = object->ptr;
+			CTDictionaryRef new_dict = CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTDictionary), 0);
+			new_dict->alloc = alloc;
+			new_dict->count = dict->count;
+			new_dict->references = 0;
+			new_dict->hash_pass = 0;
+			new_dict->elements = dict->count ? CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTDictionaryEntry *) * dict->count, 0) : NULL;
+			for (uint64_t i = 0; i < dict->count; ++i)
+			{
+				CTDictionaryEntry * entry = CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTDictionaryEntry), 0);
+				entry->key = CTStringCompactInto(alloc, region, dict->elements[i]->key);
+				entry->value = CTObjectCompactInto(alloc, region, dict->elements[i]->value);
+				new_dict->elements[i] = entry;
+			}
+			new_object->ptr = new_dict;
+			break;
+		}
+		case CTOBJECT_TYPE_ARRAY:
+		{
+			const CTArray * array = object->ptr;
+			CTArrayRef new_array = CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTArray), 0);
+			new_array->alloc = alloc;
+			new_array->count = array->count;
+			new_array->size = array->count;
+			new_array->references = 0;
+			new_array->hash_pass = 0;
+			new_array->elements = array->count ? bufferAllocateFromRegion(alloc, region, sizeof(CTObjectRef) * array->count) : NULL;
+			for (uint64_t i = 0; i < array->count; ++i)
+			{
+				new_array->elements[i] = CTObjectCompactInto(alloc, region, array->elements[i]);
+			}
+			new_object->ptr = new_array;
+			break;
+		}
+		case CTOBJECT_TYPE_STRING:
+			new_object->ptr = CTStringCompactInto(alloc, region, object->ptr);
+			break;
+		case CTOBJECT_TYPE_NUMBER:
+		{
+			CTNumberRef new_number = (CTNumberRef)(new_object + 1);
+			*new_number = *(const CTNumber *)object->ptr;
+			new_number->alloc = alloc;
+			new_number->references = 0;
+			new_object->ptr = new_number;
+			break;
+		}
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+		{
+			const CTLargeNumber * number = object->ptr;
+			CTLargeNumberRef new_number = CTAllocatorAllocateFromRegion(alloc, region, sizeof(CTLargeNumber), 0);
+			new_number->alloc = alloc;
+			new_number->references = 0;
+			new_number->base = CTNumberCompactInto(alloc, region, number->base);
+			new_number->exponent = CTNumberCompactInto(alloc, region, number->exponent);
+			new_object->ptr = new_number;
+			break;
+		}
+		case CTOBJECT_TYPE_NULL:
+		case CTOBJECT_NOT_AN_OBJECT:
+			break;
+	}
+	CTAllocatorCountObject(alloc, new_object->type, 1);
+	return new_object;
+}
+
+CTObjectRef CTObjectCompact(CTAllocatorRef restrict alloc, const CTObject * restrict object)
+{
+	CTAllocatorRegion region;
+	CTAllocatorReserve(alloc, &region, CTObjectCompactSize(object));
+	return CTObjectCompactInto(alloc, &region, object);
+}
+
+static CTStringRef CTStringAdopt(CTAllocatorRef restrict alloc, CTStringRef string)
+{
+	if (string->alloc != alloc && string->references)
+	{
+		// Dictionary keys may be shared with copies that stay behind
+		CTStringRef copy = CTStringCopy(alloc, string);
+		CTStringRelease(string);
+		return copy;
+	}
+	if (string->alloc != alloc)
+	{
+		string->characters = CTAllocatorTransfer(string->alloc, alloc, string->characters);
+		string = CTAllocatorTransfer(string->alloc, alloc, string);
+		string->alloc = alloc;
+	}
+	return string;
+}
+
+static CTNumberRef CTNumberAdopt(CTAllocatorRef restrict alloc, CTNumberRef number)
+{
+	if (number->alloc && number->alloc != alloc)
+	{
+		number = CTAllocatorTransfer(number->alloc, alloc, number);
+		number->alloc = alloc;
+	}
+	return number;
+}
+
+static CTObjectRef CTObjectAdoptEmbedded(CTAllocatorRef restrict alloc, CTObjectRef object)
+{
+	if (object->alloc == alloc)
+	{
+		return object;
+	}
+	CTStringRef string = object->type == CTOBJECT_TYPE_STRING ? object->ptr : NULL;
+	const uint8_t inline_characters = string && string->characters == (char *)(string + 1);
+	if (string && !inline_characters)
+	{
+		string->characters = CTAllocatorTransfer(object->alloc, alloc, string->characters);
+	}
+	CTAllocatorCountObject(object->alloc, object->type, -1);
+	// The value moves along with the object, which may be copied to get there, so the pointers into it are set again
+	object = CTAllocatorTransfer(object->alloc, alloc, object);
+	object->alloc = alloc;
+	object->ptr = object + 1;
+	if (object->type == CTOBJECT_TYPE_STRING)
+	{
+		string = object->ptr;
+		string->alloc = alloc;
+		if (inline_characters)
+		{
+			string->characters = (char *)(string + 1);
+		}
+	}
+	else
+	{
+		((CTNumberRef)object->ptr)->alloc = alloc;
+	}
+	CTAllocatorCountObject(alloc, object->type, 1);
+	return object;
+}
+
+CTObjectRef CTObjectAdopt(CTAllocatorRef restrict alloc, CTObjectRef object)
 {
-    switch (object->type)
-    {
-        case CTOBJECT_TYPE_DICTIONARY:
-            CTDictionaryRelease(object->ptr);
-            break;
-            
-        case CTOBJECT_TYPE_ARRAY:
-            CTArrayRelease(object->ptr);
-            break;
-            
-        case CTOBJECT_TYPE_NUMBER:
-            CTNumberRelease(object->ptr);
-			break;
-			
+	if (!object->alloc)
+	{
+		return object;
+	}
+	uint64_t * references = CTObjectReferences(object);
+	if (object->alloc != alloc && references && *references)
+	{
+		// A shared value has to stay where its other objects expect it, so the object gets a copy instead
+		CTObjectRef copy = CTObjectCopy(alloc, object);
+		CTObjectRelease(object);
+		return copy;
+	}
+	if (object->size)
+	{
+		return CTObjectAdoptEmbedded(alloc, object);
+	}
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+		{
+			CTDictionaryRef dict = object->ptr;
+			for (uint64_t i = 0; i < dict->count; ++i)
+			{
+				CTDictionaryEntry * entry = dict->elements[i];
+				entry->key = CTStringAdopt(alloc, entry->key);
+				entry->value = CTObjectAdopt(alloc, entry->value);
+				dict->elements[i] = CTAllocatorTransfer(dict->alloc, alloc, entry);
+			}
+			dict->elements = CTAllocatorTransfer(dict->alloc, alloc, dict->elements);
+			dict = CTAllocatorTransfer(dict->alloc, alloc, dict);
+			dict->alloc = alloc;
+			object->ptr = dict;
+			break;
+		}
+		case CTOBJECT_TYPE_ARRAY:
+		{
+			CTArrayRef array = object->ptr;
+			for (uint64_t i = 0; i < array->count; ++i)
+			{
+				array->elements[i] = CTObjectAdopt(alloc, array->elements[i]);
+			}
+			array->elements = CTAllocatorTransfer(array->alloc, alloc, array->elements);
+			array = CTAllocatorTransfer(array->alloc, alloc, array);
+			array->alloc = alloc;
+			object->ptr = array;
+			break;
+		}
+		case CTOBJECT_TYPE_STRING:
+			object->ptr = CTStringAdopt(alloc, object->ptr);
+			break;
+		case CTOBJECT_TYPE_NUMBER:
+			object->ptr = CTNumberAdopt(alloc, object->ptr);
+			break;
 		case CTOBJECT_TYPE_LARGE_NUMBER:
-			CTLargeNumberRelease(object->ptr);
+		{
+			CTLargeNumberRef number = object->ptr;
+			number->base = CTNumberAdopt(alloc, number->base);
+			number->exponent = CTNumberAdopt(alloc, number->exponent);
+			number = CTAllocatorTransfer(number->alloc, alloc, number);
+			number->alloc = alloc;
+			object->ptr = number;
 			break;
-            
-        case CTOBJECT_TYPE_STRING:
-            CTStringRelease(object->ptr);
-            break;
-			
+		}
 		case CTOBJECT_TYPE_NULL:
 		case CTOBJECT_NOT_AN_OBJECT:
 			break;
-    }
-    CTAllocatorDeallocate(object->alloc, object);
+	}
+	if (object->alloc != alloc)
+	{
+		CTAllocatorCountObject(object->alloc, object->type, -1);
+		object = CTAllocatorTransfer(object->alloc, alloc, object);
+		object->alloc = alloc;
+		CTAllocatorCountObject(alloc, object->type, 1);
+	}
+	return object;
+}
+
+static uint64_t CTObjectHashShallow(const CTObject * restrict object)
+{
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+			return CTDictionaryHash(object->ptr);
+		case CTOBJECT_TYPE_ARRAY:
+			return CTArrayHash(object->ptr);
+		case CTOBJECT_TYPE_NUMBER:
+			return CTNumberHash(object->ptr);
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+			return CTLargeNumberHash(object->ptr);
+		case CTOBJECT_TYPE_STRING:
+			return hashMix(CTStringHash(object->ptr) + CTOBJECT_TYPE_STRING);
+		default:
+			return hashMix(object->type);
+	}
+}
+
+static uint8_t CTObjectHashMemoized(const CTObject * restrict object)
+{
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+			return hashMemoized(((const CTDictionary *)object->ptr)->hash_pass, &((const CTDictionary *)object->ptr)->references);
+		case CTOBJECT_TYPE_ARRAY:
+			return hashMemoized(((const CTArray *)object->ptr)->hash_pass, &((const CTArray *)object->ptr)->references);
+		default:
+			return 1;
+	}
+}
+
+static uint8_t CTObjectHashEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	return !CTObjectHashMemoized(object);
+}
+
+static void CTObjectHashLeave(CTObjectWalker * walker, const CTObject * object)
+{
+	CTObjectHashShallow(object);
+}
+
+uint64_t CTObjectHash(const CTObject * restrict object)
+{
+	const uint64_t previous = hashPassEnter();
+	if (!CTObjectHashMemoized(object))
+	{
+		// Nested dictionaries and arrays are hashed innermost first, so each one only combines hashes memoized during this pass
+		CTObjectWalker walker = {CTObjectHashEnter, CTObjectHashLeave, NULL, NULL, NULL};
+		CTObjectWalk(object, &walker);
+	}
+	const uint64_t hash = CTObjectHashShallow(object);
+	hashPassLeave(previous);
+	return hash;
+}
+
+CTObjectRef CTObjectRetain(CTObjectRef object)
+{
+	if (CTObjectIsFrozen(object) && object->alloc)
+	{
+		__atomic_add_fetch(&object->frozen_references, 1, __ATOMIC_RELAXED);
+		return object;
+	}
+	return CTObjectCopy(object->alloc, object);
+}
+
+static void CTNumberFreeze(CTNumberRef number)
+{
+	if (number->alloc)
+	{
+		referencesFreeze(&number->references);
+	}
+}
+
+static uint8_t CTObjectFreezeEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	if (CTObjectIsFrozen(object) || !CTObjectReferences(object))
+	{
+		return 0;
+	}
+	if (referencesFrozen(CTObjectReferences(object)))
+	{
+		// Copies of frozen objects share a value that is frozen already, only the object itself is left
+		((CTObjectRef)object)->frozen_references = 1;
+		return 0;
+	}
+	// Fetching the value gives the object a value of its own, so freezing never reaches the trees it was copied from
+	void * value = CTObjectMutableValue((CTObjectRef)object);
+	if (object->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		CTDictionaryRef dict = value;
+		for (uint64_t i = 0; i < dict->count; ++i)
+		{
+			// Keys are shared between copies, so a key may belong to a frozen tree already and be counted from other threads
+			CTStringRef key = dict->elements[i]->key;
+			if (!referencesFrozen(&key->references))
+			{
+				CTStringHash(key);
+				referencesFreeze(&key->references);
+			}
+		}
+	}
+	return 1;
+}
+
+static void CTObjectFreezeLeave(CTObjectWalker * walker, const CTObject * object)
+{
+	// The elements are frozen by now, so their hashes are memoized for good
+	CTObjectHashShallow(object);
+	referencesFreeze(CTObjectReferences(object));
+	((CTObjectRef)object)->frozen_references = 1;
+}
+
+static void CTObjectFreezeElement(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	if (CTObjectIsFrozen(object) || !CTObjectReferences(object))
+	{
+		return;
+	}
+	if (referencesFrozen(CTObjectReferences(object)))
+	{
+		((CTObjectRef)object)->frozen_references = 1;
+		return;
+	}
+	void * value = CTObjectMutableValue((CTObjectRef)object);
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_STRING:
+			CTStringHash(value);
+			break;
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+			CTNumberFreeze(((CTLargeNumberRef)value)->base);
+			CTNumberFreeze(((CTLargeNumberRef)value)->exponent);
+			break;
+		default:
+			break;
+	}
+	CTObjectHashShallow(object);
+	referencesFreeze(CTObjectReferences(object));
+	((CTObjectRef)object)->frozen_references = 1;
+}
+
+void CTObjectFreeze(CTObjectRef object)
+{
+	// The hashes are memoized during the pass, and kept for good once the containers are frozen
+	const uint64_t previous = hashPassEnter();
+	CTObjectWalker walker = {CTObjectFreezeEnter, CTObjectFreezeLeave, CTObjectFreezeElement, NULL, NULL};
+	CTObjectWalk(object, &walker);
+	hashPassLeave(previous);
+}
+
+uint8_t CTObjectIsFrozen(const CTObject * restrict object)
+{
+	return !object->alloc || __atomic_load_n(&object->frozen_references, __ATOMIC_RELAXED) != 0;
+}
+
+typedef struct
+{
+	const CTObject * object1;
+	const CTObject * object2;
+} CTObjectComparePair;
+
+typedef struct
+{
+	CTObjectComparePair * pairs;
+	uint64_t count;
+	uint64_t capacity;
+	CTObjectComparePair inline_pairs[CTOBJECT_WALK_INLINE_FRAMES];
+} CTObjectCompareStack;
+
+static uint8_t CTObjectCompareElements(const CTObject * restrict object1, const CTObject * restrict object2, CTObjectCompareStack * stack)
+{
+	if (object1 == object2 || (object1->type == object2->type && object1->ptr && object1->ptr == object2->ptr))
+	{
+		return 1;
+	}
+	if (object1->type != object2->type)
+	{
+		return 0;
+	}
+	switch(object1->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+		case CTOBJECT_TYPE_ARRAY:
+			// Nested dictionaries and arrays are compared once the enclosing one is done, they were paired up by their structural hashes
+			if (stack->count == stack->capacity)
+			{
+				stack->pairs = stackGrow(stack->pairs, stack->inline_pairs, &stack->capacity, sizeof(CTObjectComparePair));
+			}
+			stack->pairs[stack->count++] = (CTObjectComparePair){object1, object2};
+			return 1;
+		case CTOBJECT_TYPE_NUMBER:
+			return CTNumberCompare(object1->ptr, object2->ptr);
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+			return CTLargeNumberCompare(object1->ptr, object2->ptr);
+		case CTOBJECT_TYPE_STRING:
+			return CTStringIsEqual(object1->ptr, object2->ptr);
+		case CTOBJECT_TYPE_NULL:
+			return 1;
+		case CTOBJECT_NOT_AN_OBJECT:
+			return 0;
+	}
+	return 0;
+}
+
+uint8_t CTObjectCompare(const CTObject * restrict object1, const CTObject * restrict object2)
+{
+	CTObjectCompareStack stack;
+	stack.pairs = stack.inline_pairs;
+	stack.count = 0;
+	stack.capacity = CTOBJECT_WALK_INLINE_FRAMES;
+	CTObjectCompareStack * pending = &stack;
+	// Every hash taken while comparing is memoized for the rest of the comparison, nothing is modified in between
+	const uint64_t previous = hashPassEnter();
+	uint8_t equal = CTObjectCompareElements(object1, object2, pending);
+	while (equal && stack.count)
+	{
+		CTObjectComparePair pair = stack.pairs[--stack.count];
+		if (pair.object1->type == CTOBJECT_TYPE_DICTIONARY)
+		{
+			const CTDictionary * dict1 = pair.object1->ptr, * dict2 = pair.object2->ptr;
+			equal = dict1->count == dict2->count && CTDictionaryHash(dict1) == CTDictionaryHash(dict2) && hashMatch(dict1->count, ^uint64_t(uint8_t second, uint64_t index) {
+				const CTDictionaryEntry * entry = (second ? dict2 : dict1)->elements[index];
+				return hashMix(CTStringHash(entry->key) + hashMix(CTObjectHash(entry->value)));
+			}, ^uint8_t(uint64_t index1, uint64_t index2, uint8_t only) {
+				const CTDictionaryEntry * entry1 = dict1->elements[index1], * entry2 = dict2->elements[index2];
+				return CTStringCompare(entry1->key, entry2->key) == 0 && (only ? CTObjectCompareElements(entry1->value, entry2->value, pending) : CTObjectCompare(entry1->value, entry2->value));
+			});
+		}
+		else
+		{
+			const CTArray * array1 = pair.object1->ptr, * array2 = pair.object2->ptr;
+			equal = array1->count == array2->count && CTArrayHash(array1) == CTArrayHash(array2) && hashMatch(array1->count, ^uint64_t(uint8_t second, uint64_t index) {
+				return CTObjectHash((second ? array2 : array1)->elements[index]);
+			}, ^uint8_t(uint64_t index1, uint64_t index2, uint8_t only) {
+				// Deferring the comparison commits to the pairing, which is only safe when no other element could be paired instead
+				return only ? CTObjectCompareElements(array1->elements[index1], array2->elements[index2], pending) : CTObjectCompare(array1->elements[index1], array2->elements[index2]);
+			});
+		}
+	}
+	stackRelease(stack.pairs, stack.inline_pairs);
+	hashPassLeave(previous);
+	return equal;
+}
+
+static uint8_t CTObjectCompareExactElements(const CTObject * restrict object1, const CTObject * restrict object2, CTObjectCompareStack * stack)
+{
+	if (object1 == object2 || (object1->type == object2->type && object1->ptr && object1->ptr == object2->ptr))
+	{
+		return 1;
+	}
+	if (object1->type != object2->type)
+	{
+		return 0;
+	}
+	switch(object1->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+		case CTOBJECT_TYPE_ARRAY:
+			// Memoized hashes that differ rule the pair out without visiting it, equal ones prove nothing
+			if (CTObjectHashMemoized(object1) && CTObjectHashMemoized(object2) && CTObjectHashShallow(object1) != CTObjectHashShallow(object2))
+			{
+				return 0;
+			}
+			if (stack->count == stack->capacity)
+			{
+				stack->pairs = stackGrow(stack->pairs, stack->inline_pairs, &stack->capacity, sizeof(CTObjectComparePair));
+			}
+			stack->pairs[stack->count++] = (CTObjectComparePair){object1, object2};
+			return 1;
+		case CTOBJECT_TYPE_NUMBER:
+			return CTNumberCompare(object1->ptr, object2->ptr);
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+			return CTLargeNumberCompare(object1->ptr, object2->ptr);
+		case CTOBJECT_TYPE_STRING:
+			return CTStringIsIdentical(object1->ptr, object2->ptr);
+		case CTOBJECT_TYPE_NULL:
+			return 1;
+		case CTOBJECT_NOT_AN_OBJECT:
+			return 0;
+	}
+	return 0;
+}
+
+uint8_t CTObjectCompareExact(const CTObject * restrict object1, const CTObject * restrict object2)
+{
+	CTObjectCompareStack stack;
+	stack.pairs = stack.inline_pairs;
+	stack.count = 0;
+	stack.capacity = CTOBJECT_WALK_INLINE_FRAMES;
+	const uint64_t previous = hashPassEnter();
+	uint8_t equal = CTObjectCompareExactElements(object1, object2, &stack);
+	while (equal && stack.count)
+	{
+		CTObjectComparePair pair = stack.pairs[--stack.count];
+		if (pair.object1->type == CTOBJECT_TYPE_DICTIONARY)
+		{
+			const CTDictionary * dict1 = pair.object1->ptr, * dict2 = pair.object2->ptr;
+			equal = dict1->count == dict2->count;
+			for (uint64_t i = 0; equal && i < dict1->count; ++i)
+			{
+				const CTDictionaryEntry * entry1 = dict1->elements[i], * entry2 = dict2->elements[i];
+				equal = CTStringIsIdentical(entry1->key, entry2->key) && CTObjectCompareExactElements(entry1->value, entry2->value, &stack);
+			}
+		}
+		else
+		{
+			const CTArray * array1 = pair.object1->ptr, * array2 = pair.object2->ptr;
+			equal = array1->count == array2->count;
+			for (uint64_t i = 0; equal && i < array1->count; ++i)
+			{
+				equal = CTObjectCompareExactElements(array1->elements[i], array2->elements[i], &stack);
+			}
+		}
+	}
+	stackRelease(stack.pairs, stack.inline_pairs);
+	hashPassLeave(previous);
+	return equal;
+}
+
+inline void * CTObjectValue(const CTObject * restrict object)
+{
+	assert(object);
+	return object->ptr;
+}
+
+inline CTOBJECT_TYPE CTObjectType(const CTObject * restrict object)
+{
+	assert(object);
+	return object->type;
+}
+
+inline uint64_t CTObjectSize(const CTObject * restrict object)
+{
+	assert(object);
+	return object->size;
+}
+
+static void CTObjectFootprintCount(CTObjectFootprint * footprint, uint64_t * field, uint64_t bytes, uint8_t shared)
+{
+	*field += bytes;
+	footprint->total += bytes;
+	if (shared)
+	{
+		footprint->shared += bytes;
+	}
+}
+
+static void CTStringFootprint(CTObjectFootprint * footprint, const CTString * restrict string, uint8_t shared)
+{
+	shared = shared || string->references;
+	footprint->blocks += 2;
+	CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(string), shared);
+	CTObjectFootprintCount(footprint, &footprint->strings, CTAllocatorBlockSize(string->characters), shared);
+}
+
+static void CTObjectFootprintAdd(CTObjectFootprint * footprint, const CTObject * restrict object, uint8_t shared)
+{
+	if (!object->alloc)
+	{
+		return;
+	}
+	uint64_t * references = CTObjectReferences(object);
+	++footprint->blocks;
+	if (object->size)
+	{
+		// The value is part of the object's block, strings only own a block of characters once they outgrow it
+		shared = shared || *references;
+		uint64_t inline_bytes = 0;
+		if (object->type == CTOBJECT_TYPE_STRING)
+		{
+			const CTString * string = object->ptr;
+			if (string->characters == (const char *)(string + 1))
+			{
+				inline_bytes = string->length + 1;
+			}
+			else
+			{
+				++footprint->blocks;
+				CTObjectFootprintCount(footprint, &footprint->strings, CTAllocatorBlockSize(string->characters), shared);
+			}
+		}
+		CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(object) - inline_bytes, shared);
+		CTObjectFootprintCount(footprint, &footprint->strings, inline_bytes, shared);
+		return;
+	}
+	CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(object), shared || CTObjectIsFrozen(object));
+	shared = shared || (references && *references);
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+		{
+			// Only the dictionary's own blocks, its values are visited by CTObjectWalk
+			const CTDictionary * dict = object->ptr;
+			++footprint->blocks;
+			CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(dict), shared);
+			if (dict->elements)
+			{
+				++footprint->blocks;
+				CTObjectFootprintCount(footprint, &footprint->dictionary_tables, CTAllocatorBlockSize(dict->elements), shared);
+			}
+			for (uint64_t i = 0; i < dict->count; ++i)
+			{
+				++footprint->blocks;
+				CTObjectFootprintCount(footprint, &footprint->dictionary_tables, CTAllocatorBlockSize(dict->elements[i]), shared);
+				CTStringFootprint(footprint, dict->elements[i]->key, shared);
+			}
+			break;
+		}
+		case CTOBJECT_TYPE_ARRAY:
+		{
+			const CTArray * array = object->ptr;
+			++footprint->blocks;
+			CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(array), shared);
+			if (array->elements)
+			{
+				const uint64_t slack = array->size > array->count ? (array->size - array->count) * sizeof(CTObjectRef) : 0;
+				++footprint->blocks;
+				CTObjectFootprintCount(footprint, &footprint->array_tables, CTAllocatorBlockSize(array->elements) - slack, shared);
+				CTObjectFootprintCount(footprint, &footprint->array_slack, slack, shared);
+			}
+			break;
+		}
+		case CTOBJECT_TYPE_STRING:
+			CTStringFootprint(footprint, object->ptr, shared);
+			break;
+		case CTOBJECT_TYPE_NUMBER:
+			++footprint->blocks;
+			CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(object->ptr), shared);
+			break;
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+		{
+			const CTLargeNumber * number = object->ptr;
+			++footprint->blocks;
+			CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(number), shared);
+			const CTNumber * parts[] = {number->base, number->exponent};
+			for (uint8_t i = 0; i < 2; ++i)
+			{
+				if (parts[i]->alloc)
+				{
+					++footprint->blocks;
+					CTObjectFootprintCount(footprint, &footprint->headers, CTAllocatorBlockSize(parts[i]), shared);
+				}
+			}
+			break;
+		}
+		case CTOBJECT_TYPE_NULL:
+		case CTOBJECT_NOT_AN_OBJECT:
+			break;
+	}
+}
+
+static uint8_t CTObjectFootprintEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	if (!object->alloc)
+	{
+		return 0;
+	}
+	uint8_t shared = walker->data != NULL;
+	CTObjectFootprintAdd(walker->context, object, shared);
+	// Everything below a value with several owners is shared as well
+	walker->data = (void *)(uintptr_t)(shared || *CTObjectReferences(object));
+	return 1;
+}
+
+static void CTObjectFootprintElement(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTObjectFootprintAdd(walker->context, object, walker->data != NULL);
+}
+
+CTObjectFootprint CTObjectGetFootprint(const CTObject * restrict object)
+{
+	CTObjectFootprint footprint = {0};
+	CTObjectWalker walker = {CTObjectFootprintEnter, NULL, CTObjectFootprintElement, &footprint, NULL};
+	CTObjectWalk(object, &walker);
+	return footprint;
+}
+
+uint64_t CTObjectDeepSize(const CTObject * restrict object)
+{
+	return CTObjectGetFootprint(object).total;
+}
+
+static void CTObjectReleaseHeader(CTObjectWalker * walker, CTObjectRef owner)
+{
+	// CTObjectReleaseValue walks an object on the C stack, which is left alone
+	if (!walker || owner != walker->context)
+	{
+		CTAllocatorCountObject(owner->alloc, owner->type, -1);
+		CTAllocatorDeallocate(owner->alloc, owner);
+	}
+}
+
+static void CTObjectReleaseElement(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTObjectRef owner = (CTObjectRef)object;
+	if (!owner->alloc)
+	{
+		// Shared objects such as CTObjectWithBool and CTObjectNull are never deallocated
+		return;
+	}
+	if (owner->frozen_references && __atomic_sub_fetch(&owner->frozen_references, 1, __ATOMIC_ACQ_REL))
+	{
+		// Other holders of the frozen object still use it
+		return;
+	}
+	uint64_t * references = CTObjectReferences(owner);
+	if (references && referencesFrozen(references) && referencesRelease(references))
+	{
+		// Copies of the frozen object still use its value, so only the object itself goes
+		CTObjectReleaseHeader(walker, owner);
+		return;
+	}
+	if (owner->size)
+	{
+		// The value shares the object's allocation, only the characters of a string that outgrew it are separate
+		if (owner->type == CTOBJECT_TYPE_STRING)
+		{
+			CTStringReleaseEmbedded(owner->ptr);
+		}
+		CTObjectReleaseHeader(walker, owner);
+		return;
+	}
+	switch (owner->type)
+	{
+		case CTOBJECT_TYPE_NUMBER:
+			CTNumberRelease(owner->ptr);
+			break;
+		case CTOBJECT_TYPE_LARGE_NUMBER:
+			CTLargeNumberRelease(owner->ptr);
+			break;
+		case CTOBJECT_TYPE_STRING:
+			CTStringRelease(owner->ptr);
+			break;
+		default:
+			break;
+	}
+	CTObjectReleaseHeader(walker, owner);
+}
+
+static uint8_t CTObjectReleaseEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTObjectRef owner = (CTObjectRef)object;
+	if (owner->frozen_references && __atomic_sub_fetch(&owner->frozen_references, 1, __ATOMIC_ACQ_REL))
+	{
+		// Other holders of the frozen object still use it
+		return 0;
+	}
+	if (referencesRelease(CTObjectReferences(owner)))
+	{
+		// The value is shared with copies of the object, so only the object itself goes
+		CTObjectReleaseHeader(walker, owner);
+		return 0;
+	}
+	return 1;
+}
+
+static void CTObjectReleaseLeave(CTObjectWalker * walker, const CTObject * object)
+{
+	// The elements have been released by now, only the tables holding them are left
+	CTObjectRef owner = (CTObjectRef)object;
+	if (owner->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		CTDictionaryRef dict = owner->ptr;
+		for (uint64_t i = 0; i < dict->count; ++i)
+		{
+			CTStringRelease(dict->elements[i]->key);
+			CTAllocatorDeallocate(dict->alloc, dict->elements[i]);
+		}
+		CTAllocatorDeallocate(dict->alloc, dict->elements);
+		CTAllocatorDeallocate(dict->alloc, dict);
+	}
+	else
+	{
+		CTArrayRef array = owner->ptr;
+		CTAllocatorDeallocate(array->alloc, array->elements);
+		CTAllocatorDeallocate(array->alloc, array);
+	}
+	CTObjectReleaseHeader(walker, owner);
+}
+
+void CTObjectRelease(CTObjectRef object)
+{
+	if (!CTObjectIsContainer(object))
+	{
+		CTObjectReleaseElement(NULL, object, NULL, 0);
+		return;
+	}
+	CTObjectWalker walker = {CTObjectReleaseEnter, CTObjectReleaseLeave, CTObjectReleaseElement, NULL, NULL};
+	CTObjectWalk(object, &walker);
+}
+
+static void CTObjectReleaseValue(CTAllocatorRef restrict alloc, void * value, CTOBJECT_TYPE type)
+{
+	// Drops one reference to a value without an object of its own, the object walked is on the C stack and only stands in for one
+	CTObject object = {.alloc = alloc, .ptr = value, .type = type};
+	CTObjectWalker walker = {CTObjectReleaseEnter, CTObjectReleaseLeave, CTObjectReleaseElement, &object, NULL};
+	if (!CTObjectIsContainer(&object))
+	{
+		CTObjectReleaseElement(&walker, &object, NULL, 0);
+		return;
+	}
+	CTObjectWalk(&object, &walker);
+}
+
+void * CTObjectMutableValue(CTObjectRef object)
+{
+	assert(object);
+	if (CTObjectIsFrozen(object))
+	{
+		return object->ptr;
+	}
+	uint64_t * references = CTObjectReferences(object);
+	if (references && *references)
+	{
+		// Copy on write, the copy only duplicates this level and shares everything below it
+		void * value = object->ptr;
+		const uint8_t frozen = referencesFrozen(references);
+		if (!frozen)
+		{
+			--*references;
+		}
+		switch (object->type)
+		{
+			case CTOBJECT_TYPE_DICTIONARY:
+				object->ptr = CTDictionaryCopy(object->alloc, object->ptr);
+				break;
+			case CTOBJECT_TYPE_ARRAY:
+				object->ptr = CTArrayCopy(object->alloc, object->ptr);
+				break;
+			case CTOBJECT_TYPE_NUMBER:
+				object->ptr = CTNumberCopy(object->alloc, object->ptr);
+				break;
+			case CTOBJECT_TYPE_LARGE_NUMBER:
+				object->ptr = CTLargeNumberCopy(object->alloc, object->ptr);
+				break;
+			case CTOBJECT_TYPE_STRING:
+				object->ptr = CTStringCopy(object->alloc, object->ptr);
+				break;
+			default:
+				break;
+		}
+		if (frozen)
+		{
+			// Other threads may hold the frozen value too, so it is let go of the way they do, which frees it if this was the last copy
+			CTObjectReleaseValue(object->alloc, value, object->type);
+		}
+	}
+	// Every dictionary and array on the way to a modification is fetched here, so dropping their memoized hashes keeps the hashes above it current
+	if (object->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		((CTDictionaryRef)object->ptr)->hash_pass = 0;
+	}
+	else if (object->type == CTOBJECT_TYPE_ARRAY)
+	{
+		((CTArrayRef)object->ptr)->hash_pass = 0;
+	}
+	return object->ptr;
+}
+
+
+static uint64_t CTObjectHolderThreads = 0;
+static __thread uint64_t CTObjectHolderThreadSlot = 0;
+
+CTObjectHolderRef CTObjectHolderCreate(CTAllocatorRef restrict alloc, CTObjectRef object)
+{
+	CTObjectHolderRef holder = CTAllocatorAllocateAligned(alloc, sizeof(CTObjectHolder), 64, 0);
+	holder->alloc = alloc;
+	pthread_mutex_init(&holder->writer, NULL);
+	if (object)
+	{
+		CTObjectFreeze(object);
+	}
+	holder->object = object;
+	return holder;
+}
+
+CTObjectRef CTObjectHolderReadLock(CTObjectHolderRef restrict holder, uint64_t * section)
+{
+	if (!CTObjectHolderThreadSlot)
+	{
+		CTObjectHolderThreadSlot = __atomic_add_fetch(&CTObjectHolderThreads, 1, __ATOMIC_RELAXED);
+	}
+	uint64_t slot = CTObjectHolderThreadSlot % CTOBJECT_HOLDER_SLOTS;
+	uint64_t epoch = __atomic_load_n(&holder->epoch, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&holder->slots[slot].readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+	// A writer may have switched epochs and stopped waiting for this one before the reader was counted, so count it in the new epoch instead
+	while (__atomic_load_n(&holder->epoch, __ATOMIC_SEQ_CST) != epoch)
+	{
+		__atomic_sub_fetch(&holder->slots[slot].readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+		epoch = __atomic_load_n(&holder->epoch, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&holder->slots[slot].readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+	}
+	*section = slot << 1 | (epoch & 1);
+	return __atomic_load_n(&holder->object, __ATOMIC_SEQ_CST);
+}
+
+void CTObjectHolderReadUnlock(CTObjectHolderRef restrict holder, uint64_t section)
+{
+	__atomic_sub_fetch(&holder->slots[section >> 1].readers[section & 1], 1, __ATOMIC_RELEASE);
+}
+
+void CTObjectHolderPublish(CTObjectHolderRef restrict holder, CTObjectRef object)
+{
+	CTObjectFreeze(object);
+	pthread_mutex_lock(&holder->writer);
+	CTObjectRef previous = __atomic_exchange_n(&holder->object, object, __ATOMIC_SEQ_CST);
+	uint64_t epoch = __atomic_fetch_add(&holder->epoch, 1, __ATOMIC_SEQ_CST) & 1;
+	for (uint64_t i = 0; i < CTOBJECT_HOLDER_SLOTS; ++i)
+	{
+		while (__atomic_load_n(&holder->slots[i].readers[epoch], __ATOMIC_ACQUIRE))
+		{
+			sched_yield();
+		}
+	}
+	pthread_mutex_unlock(&holder->writer);
+	if (previous)
+	{
+		CTObjectRelease(previous);
+	}
+}
+
+void CTObjectHolderRelease(CTObjectHolderRef holder)
+{
+	if (holder->object)
+	{
+		CTObjectRelease(holder->object);
+	}
+	pthread_mutex_destroy(&holder->writer);
+	CTAllocatorDeallocate(holder->alloc, holder);
+}
+
+#define CTOBJECT_INTERN_MINIMUM_CAPACITY 0x40
+
+CTObjectInternTableRef CTObjectInternTableCreate(CTAllocatorRef restrict alloc)
+{
+	CTObjectInternTableRef table = CTAllocatorAllocate(alloc, sizeof(CTObjectInternTable));
+	table->alloc = alloc;
+	table->capacity = CTOBJECT_INTERN_MINIMUM_CAPACITY;
+	table->entries = CTAllocatorAllocate(alloc, sizeof(CTObjectInternEntry) * table->capacity);
+	return table;
+}
+
+static void CTObjectInternGrow(CTObjectInternTableRef restrict table)
+{
+	CTObjectInternEntry * entries = table->entries;
+	const uint64_t capacity = table->capacity;
+	table->capacity *= 2;
+	table->entries = CTAllocatorAllocate(table->alloc, sizeof(CTObjectInternEntry) * table->capacity);
+	for (uint64_t i = 0; i < capacity; ++i)
+	{
+		if (entries[i].value)
+		{
+			uint64_t j = entries[i].hash & (table->capacity - 1);
+			while (table->entries[j].value)
+			{
+				j = (j + 1) & (table->capacity - 1);
+			}
+			table->entries[j] = entries[i];
+		}
+	}
+	CTAllocatorDeallocate(table->alloc, entries);
+}
+
+static CTObjectInternEntry * CTObjectInternFind(CTObjectInternTableRef restrict table, uint64_t hash, void * value, uint8_t key)
+{
+	if ((table->count + 1) * 4 > table->capacity * 3)
+	{
+		CTObjectInternGrow(table);
+	}
+	++table->lookups;
+	// Open addressing with linear probing, the entry returned is either an equal one or the empty one to insert into
+	for (uint64_t i = hash & (table->capacity - 1);; i = (i + 1) & (table->capacity - 1))
+	{
+		CTObjectInternEntry * entry = &table->entries[i];
+		if (!entry->value)
+		{
+			return entry;
+		}
+		if (entry->hash == hash && entry->key == key && (key ? CTStringIsIdentical(entry->value, value) : CTObjectCompareExact(entry->value, value)))
+		{
+			++table->hits;
+			return entry;
+		}
+	}
+}
+
+static uint64_t CTObjectInternHash(const CTObject * restrict object)
+{
+	// CTObjectHash ignores the order of elements and hashes strings loosely, so every element is mixed with its index and every string is hashed byte for byte
+	switch (object->type)
+	{
+		case CTOBJECT_TYPE_DICTIONARY:
+		{
+			const CTDictionary * dict = object->ptr;
+			uint64_t hash = hashMix(CTOBJECT_TYPE_DICTIONARY + dict->count);
+			for (uint64_t i = 0; i < dict->count; ++i)
+			{
+				const CTString * key = dict->elements[i]->key;
+				hash += hashMix(hashBytes(CTStringUTF8String(key), CTStringLength(key)) + hashMix(CTObjectHash(dict->elements[i]->value) + i));
+			}
+			return hashMix(hash);
+		}
+		case CTOBJECT_TYPE_ARRAY:
+		{
+			const CTArray * array = object->ptr;
+			uint64_t hash = hashMix(CTOBJECT_TYPE_ARRAY + array->count);
+			for (uint64_t i = 0; i < array->count; ++i)
+			{
+				hash += hashMix(CTObjectHash(array->elements[i]) + i);
+			}
+			return hashMix(hash);
+		}
+		case CTOBJECT_TYPE_STRING:
+			return hashMix(hashBytes(CTStringUTF8String(object->ptr), CTStringLength(object->ptr)) + CTOBJECT_TYPE_STRING);
+		default:
+			return CTObjectHash(object);
+	}
+}
+
+static CTStringRef CTObjectInternKey(CTObjectInternTableRef restrict table, CTStringRef key)
+{
+	if (key->alloc != table->alloc)
+	{
+		return key;
+	}
+	const uint64_t hash = hashMix(hashBytes(CTStringUTF8String(key), CTStringLength(key)));
+	CTObjectInternEntry * entry = CTObjectInternFind(table, hash, key, 1);
+	if (entry->value)
+	{
+		CTStringRef canonical = entry->value;
+		if (canonical != key)
+		{
+			referencesRetain(&canonical->references);
+			CTStringRelease(key);
+		}
+		return canonical;
+	}
+	if (!referencesFrozen(&key->references))
+	{
+		CTStringHash(key);
+		referencesFreeze(&key->references);
+	}
+	referencesRetain(&key->references);
+	*entry = (CTObjectInternEntry){hash, key, 1};
+	++table->count;
+	++table->keys;
+	return key;
+}
+
+static CTObjectRef CTObjectInternObject(CTObjectInternTableRef restrict table, CTObjectRef object)
+{
+	if (object->alloc != table->alloc || !CTObjectReferences(object))
+	{
+		// Shared objects such as CTObjectWithBool and CTObjectNull are already unique
+		return object;
+	}
+	const uint64_t hash = CTObjectInternHash(object);
+	CTObjectInternEntry * entry = CTObjectInternFind(table, hash, object, 0);
+	if (entry->value)
+	{
+		CTObjectRef canonical = entry->value;
+		if (canonical != object)
+		{
+			canonical = CTObjectRetain(canonical);
+			CTObjectRelease(object);
+		}
+		return canonical;
+	}
+	// The elements are frozen already, so freezing only reaches the object itself, and the table's reference is the object itself too
+	CTObjectFreeze(object);
+	*entry = (CTObjectInternEntry){hash, CTObjectRetain(object), 0};
+	++table->count;
+	return object;
+}
+
+static uint8_t CTObjectInternEnter(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index)
+{
+	CTObjectInternTableRef table = walker->context;
+	if (object->alloc != table->alloc || CTObjectIsFrozen(object) || referencesFrozen(CTObjectReferences(object)))
+	{
+		return 0;
+	}
+	// The elements are replaced as they are interned, so the object needs a value of its own
+	CTObjectMutableValue((CTObjectRef)object);
+	return 1;
+}
+
+static void CTObjectInternLeave(CTObjectWalker * walker, const CTObject * object)
+{
+	CTObjectInternTableRef table = walker->context;
+	if (object->type == CTOBJECT_TYPE_DICTIONARY)
+	{
+		CTDictionaryRef dict = object->ptr;
+		for (uint64_t i = 0; i < dict->count; ++i)
+		{
+			dict->elements[i]->key = CTObjectInternKey(table, dict->elements[i]->key);
+			dict->elements[i]->value = CTObjectInternObject(table, dict->elements[i]->value);
+		}
+	}
+	else
+	{
+		CTArrayRef array = object->ptr;
+		for (uint64_t i = 0; i < array->count; ++i)
+		{
+			array->elements[i] = CTObjectInternObject(table, array->elements[i]);
+		}
+	}
+}
+
+CTObjectRef CTObjectIntern(CTObjectInternTableRef restrict table, CTObjectRef object)
+{
+	const uint64_t previous = hashPassEnter();
+	CTObjectWalker walker = {CTObjectInternEnter, CTObjectInternLeave, NULL, table, NULL};
+	CTObjectWalk(object, &walker);
+	object = CTObjectInternObject(table, object);
+	hashPassLeave(previous);
+	return object;
+}
+
+CTObjectInternStats CTObjectInternTableGetStats(const CTObjectInternTable * restrict table)
+{
+	CTObjectInternStats stats = {table->lookups, table->hits, table->count - table->keys, table->keys, 0};
+	stats.hit_rate = table->lookups ? (double)table->hits / table->lookups : 0;
+	return stats;
+}
+
+void CTObjectInternTableRelease(CTObjectInternTableRef table)
+{
+	for (uint64_t i = 0; i < table->capacity; ++i)
+	{
+		if (table->entries[i].value)
+		{
+			if (table->entries[i].key)
+			{
+				CTStringRelease(table->entries[i].value);
+			}
+			else
+			{
+				CTObjectRelease(table->entries[i].value);
+			}
+		}
+	}
+	CTAllocatorDeallocate(table->alloc, table->entries);
+	CTAllocatorDeallocate(table->alloc, table);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 #pragma once
 #include "CTAllocator.h"
+#include <pthread.h>
 
 #define CTObjectNonNilAndType(OBJECT, TYPE) \
 	(OBJECT != NULL && CTObjectType(OBJECT) == TYPE)
@@ -30,18 +31,260 @@ typedef struct
     uint64_t size;
     void * ptr;
     CTOBJECT_TYPE type;
+    // The holders of a frozen object, which CTObjectRetain hands the object itself, 0 for objects that are not frozen
+    uint32_t frozen_references;
 } CTObject, * CTObjectRef;
 
+/**
+ * The memory owned by an object and everything within it, see CTObjectGetFootprint. Every allocator block is counted whole, including its header and rounding, and the fields from headers to dictionary_tables add up to total.
+ * headers counts the CTObject, CTDictionary, CTArray, CTString, CTNumber and CTLargeNumber structs, including values embedded in their objects, strings counts the characters of strings and dictionary keys, array_tables and array_slack split the element tables of arrays into the slots in use and those left over from growing them, see kArrayGrowthFactor, and dictionary_tables counts the element tables and entries of dictionaries.
+ * shared is the part of total that is shared with copies or frozen, which releasing the object alone does not free. Values shared more than once within the same tree are counted every time they are reached.
+ **/
+typedef struct
+{
+	uint64_t total;
+	uint64_t blocks;
+	uint64_t headers;
+	uint64_t strings;
+	uint64_t array_tables;
+	uint64_t array_slack;
+	uint64_t dictionary_tables;
+	uint64_t shared;
+} CTObjectFootprint;
+
+typedef struct CTObjectWalker CTObjectWalker;
+
+/**
+ * The visitor CTObjectWalk calls back as it traverses a tree. Each callback is passed the object, the dictionary or array it was found in, or NULL for the root, and its index there, so the key of a dictionary value is the key of the parent's entry at that index.
+ * enter is called for every dictionary and array before its elements, and returns 0 to skip them, in which case leave is not called for it either. leave is called once all of the elements have been visited, and scalar is called for every other object. Any of the callbacks can be NULL.
+ * context is left for the caller. data is a value of the caller's for each dictionary or array being walked: it holds the value of the parent when enter or scalar is called, enter can set it for its elements, and it holds the value of the object itself again when leave is called.
+ **/
+struct CTObjectWalker
+{
+	uint8_t (*enter)(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index);
+	void (*leave)(CTObjectWalker * walker, const CTObject * object);
+	void (*scalar)(CTObjectWalker * walker, const CTObject * object, const CTObject * parent, uint64_t index);
+	void * context;
+	void * data;
+};
+
 inline void * CTObjectValueIfNonNilAndType(CTObjectRef object, CTOBJECT_TYPE type);
 CTObjectRef CTObjectCreate(CTAllocatorRef restrict alloc, void * ptr, CTOBJECT_TYPE type);
+/**
+ * Create an object with room for its value in the same allocation, directly behind the object, so that reading a scalar touches a single block. Used by CTObjectWithCharacters, CTObjectWithDouble and the like, the value must be filled in by the caller and is released along with the object.
+ * @param alloc	A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param size	The size of the value in bytes, which becomes the object's size.
+ * @param type	The type of the value.
+ * @return		An object whose ptr points to size zeroed bytes.
+ **/
+CTObjectRef CTObjectCreateWithEmbeddedValue(CTAllocatorRef restrict alloc, uint64_t size, CTOBJECT_TYPE type);
+/**
+ * Copy an object. When alloc is the allocator the object was created with, the copy shares the object's value and everything within it, so copying is O(1) regardless of size. Shared values are copied one level at a time when they are fetched with CTObjectMutableValue, see below. Copies of frozen objects share their values the same way but are never frozen themselves, use CTObjectRetain to hold on to the frozen object instead. Objects created with another allocator are copied deeply.
+ * @param alloc		A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param object	The object to copy.
+ * @return			Returns a new object that compares equal to object.
+ **/
 CTObjectRef CTObjectCopy(CTAllocatorRef restrict alloc, const CTObject * restrict object);
+/**
+ * Deep copy an object into a single region of contiguous memory, laid out in depth first order, so that traversing the copy touches as few cache lines and pages as possible. The copy can be used and modified like one made with CTObjectCopy, but its memory is only returned once the allocator is emptied or released, so compaction suits long lived documents.
+ * @param alloc		A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param object	The object to copy, which is left untouched.
+ * @return			Returns the compacted copy.
+ **/
+CTObjectRef CTObjectCompact(CTAllocatorRef restrict alloc, const CTObject * restrict object);
+/**
+ * Move an object and everything it contains over to another allocator without copying it, so that it outlives the allocator it was created with. Strings, element tables and other individually allocated blocks are handed over in place, see CTAllocatorTransfer, only blocks too small to be allocated on their own are copied.
+ * @param alloc		The CTAllocator to move the object to.
+ * @param object	The object to move, which must not be used again, use the returned object instead.
+ * @return			Returns the object, now owned by alloc.
+ **/
+CTObjectRef CTObjectAdopt(CTAllocatorRef restrict alloc, CTObjectRef object);
+/**
+ * Fetch the value of an object for reading. The value may be shared with copies of the object, so it must not be modified, use CTObjectMutableValue for that. Reading never writes to the object, so any number of threads can read the same tree at once.
+ * @param object	A properly initialised CTObject.
+ * @return			Returns the CTDictionary, CTArray, CTString, CTNumber or CTLargeNumber the object holds.
+ **/
 void * CTObjectValue(const CTObject * restrict object);
+/**
+ * Fetch the value of an object so that it can be modified with CTArrayAddEntry2, CTDictionaryAddEntry2 and the like. If the value is shared with copies of the object, it is first replaced with a copy of its own, whose elements are in turn shared with the original until they are fetched, so only the path to a modification is ever copied. Every dictionary and array on the path must be fetched with it, which also drops their memoized hashes, see CTObjectHash. Values must be fetched again after the object is copied, mutating a value that is still shared fails an assertion.
+ * @param object	A properly initialised CTObject, which must not be in use by other threads.
+ * @return			Returns the CTDictionary, CTArray, CTString, CTNumber or CTLargeNumber the object holds.
+ **/
+void * CTObjectMutableValue(CTObjectRef object);
+/**
+ * Take another reference to an object. Retaining a frozen object returns the object itself and never touches its allocator, so it can be done from any thread, other objects are copied with the allocator they were created with, see CTObjectCopy.
+ * @param object	A properly initialised CTObject.
+ * @return			Returns an object to release with CTObjectRelease once it is no longer needed.
+ **/
+CTObjectRef CTObjectRetain(CTObjectRef object);
+/**
+ * Make an object and everything within it immutable, so that it can be read from many threads at once without locking. String hashes are computed up front, so lookups such as CTDictionaryObjectForKey never write to a frozen tree, CTObjectMutableValue returns frozen values as they are, and the mutators fail an assertion on them. References to frozen objects are counted atomically, so each thread can hold its own with CTObjectRetain and CTObjectRelease. The tree is freed by whichever thread releases the last reference, which must be allowed to use the object's allocator, see CTAllocatorCreateShared.
+ * @param object	The object to freeze, which must not be in use by other threads yet.
+ **/
+void CTObjectFreeze(CTObjectRef object);
+/**
+ * Check whether an object was frozen with CTObjectFreeze. Shared objects such as CTObjectNull count as frozen.
+ * @param object	A properly initialised CTObject.
+ * @return			A value indicating whether the object is frozen, 0 = false, 1 = true.
+ **/
+uint8_t CTObjectIsFrozen(const CTObject * restrict object);
 CTOBJECT_TYPE CTObjectType(const CTObject * restrict object);
+/**
+ * Fetch the size of the value embedded in an object, see CTObjectCreateWithEmbeddedValue.
+ * @param object	A properly initialised CTObject.
+ * @return			The number of bytes of the value stored in the object's own allocation, 0 if the value is allocated separately.
+ **/
 uint64_t CTObjectSize(const CTObject * restrict object);
 /**
- * Compare two CTObject objects
+ * Measure the memory owned by an object and everything within it, broken down by what it is used for. Shared objects such as CTObjectNull take up no memory of their own.
+ * @param object	A properly initialised CTObject.
+ * @return			The footprint of the object, see CTObjectFootprint.
+ **/
+CTObjectFootprint CTObjectGetFootprint(const CTObject * restrict object);
+/**
+ * Measure the total memory owned by an object and everything within it, for enforcing memory budgets or sizing caches by bytes.
+ * @param object	A properly initialised CTObject.
+ * @return			The total of CTObjectGetFootprint.
+ **/
+uint64_t CTObjectDeepSize(const CTObject * restrict object);
+/**
+ * Compare two CTObject objects. Dictionaries are equal when they hold equal values under equal keys, and arrays when they hold equal elements regardless of their order. Repeated elements are counted, so [1, 1, 2] and [1, 2, 2] are not equal, where they used to be because each element only had to have an equal one somewhere in the other array. Dictionaries and arrays with different hashes are told apart without comparing their elements.
  * @param array	A properly initialised CTObject that was created with CTObjectCreate* or CTObjectWith*.
  * @return		A value indicating equality, 0 = false, 1 = true.
  **/
 uint8_t CTObjectCompare(const CTObject * restrict object1, const CTObject * restrict object2);
-void CTObjectRelease(CTObjectRef object);
\ No newline at end of file
+/**
+ * Compare two CTObject objects exactly: dictionaries entry by entry and arrays element by element in order, strings and keys byte for byte, and numbers only with numbers of the same type. Hashes are only used to tell unequal objects apart early.
+ * @return		A value indicating equality, 0 = false, 1 = true.
+ **/
+uint8_t CTObjectCompareExact(const CTObject * restrict object1, const CTObject * restrict object2);
+/**
+ * Compute the structural hash of an object, equal objects as told by CTObjectCompare have equal hashes. The hashes of dictionaries and arrays are independent of the order of their elements, and are memoized in each dictionary and array. Frozen objects keep their hashes for good, CTObjectFreeze computes them up front. Other dictionaries and arrays may be modified through a value fetched earlier without their parents noticing, so their hashes are only trusted for the rest of the call that memoized them, such as one CTObjectHash, CTObjectCompare or CTObjectDiff, and are computed again by the next one.
+ * @param object	A properly initialised CTObject.
+ * @return			The hash of the object, which is suitable as a cache key or for finding duplicate documents.
+ **/
+uint64_t CTObjectHash(const CTObject * restrict object);
+/**
+ * Visit an object and everything within it depth first, in the order of the elements of each dictionary and array. The walk keeps its own stack rather than recursing, so trees of any depth can be walked in memory proportional to their depth. Copying, hashing, freezing, releasing and serialising objects are built on it, and CTObjectCompare walks pairs of trees with a stack of its own in the same way. Values are read as they are, so the callbacks must fetch values with CTObjectMutableValue before modifying them.
+ * @param object	The object to start from.
+ * @param walker	The callbacks to call, see CTObjectWalker.
+ **/
+void CTObjectWalk(const CTObject * restrict object, CTObjectWalker * walker);
+void CTObjectRelease(CTObjectRef object);
+
+#define CTOBJECT_HOLDER_SLOTS 64
+
+/**
+ * Holds the current version of a document that is read by many threads and replaced every now and then, such as a configuration or routing table. Readers count themselves in one of a number of cache line sized slots, so reading scales with cores, and a replaced document is only released once every reader that could have seen it has left.
+ **/
+typedef struct
+{
+	CTAllocatorRef alloc;
+	CTObjectRef object;
+	uint64_t epoch;
+	pthread_mutex_t writer;
+	struct
+	{
+		uint64_t readers[2];
+	} __attribute__((aligned(64))) slots[CTOBJECT_HOLDER_SLOTS];
+} CTObjectHolder, * CTObjectHolderRef;
+
+/**
+ * Create a holder for a document.
+ * @param alloc		A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param object	The first version of the document, or NULL. The holder takes ownership of it and freezes it, see CTObjectFreeze.
+ * @return			Returns an initialised CTObjectHolder.
+ **/
+CTObjectHolderRef CTObjectHolderCreate(CTAllocatorRef restrict alloc, CTObjectRef object);
+
+/**
+ * Enter a read-side critical section and return the current document. The section never waits for a writer, and the document stays valid until CTObjectHolderReadUnlock is called, retain it with CTObjectRetain to keep it for longer.
+ * @param holder	The holder to read from.
+ * @param section	Receives the section to pass to CTObjectHolderReadUnlock.
+ * @return			Returns the current, frozen document.
+ **/
+CTObjectRef CTObjectHolderReadLock(CTObjectHolderRef restrict holder, uint64_t * section);
+
+/**
+ * Leave a read-side critical section entered with CTObjectHolderReadLock. The document returned by it must not be used afterwards.
+ * @param holder	The holder that was read from.
+ * @param section	The section returned by CTObjectHolderReadLock.
+ **/
+void CTObjectHolderReadUnlock(CTObjectHolderRef restrict holder, uint64_t section);
+
+/**
+ * Replace the document held by a holder. New readers see the new document straight away, the previous one is released with CTObjectRelease once every reader that could still be using it has left, which the calling thread waits for.
+ * @param holder	The holder to publish to.
+ * @param object	The new version of the document. The holder takes ownership of it and freezes it, see CTObjectFreeze.
+ **/
+void CTObjectHolderPublish(CTObjectHolderRef restrict holder, CTObjectRef object);
+
+/**
+ * Release a holder and the document it holds. No thread may be reading from it.
+ * @param holder	The holder to release.
+ **/
+void CTObjectHolderRelease(CTObjectHolderRef holder);
+
+/**
+ * An entry of a CTObjectInternTable, either a frozen object or a frozen dictionary key.
+ **/
+typedef struct
+{
+	uint64_t hash;
+	void * value;
+	uint8_t key;
+} CTObjectInternEntry;
+
+/**
+ * A table of the objects and dictionary keys that CTObjectIntern has seen, keyed by hashes that take the order of elements into account and confirmed with CTObjectCompareExact, so only identical subtrees are ever merged. Equal subtrees of the documents interned into the same table end up as one frozen object that every document shares, which is what repetitive documents such as telemetry records are mostly made of. Tables are not thread safe, but the objects they hand out are frozen like any other.
+ **/
+typedef struct
+{
+	CTAllocatorRef alloc;
+	CTObjectInternEntry * entries;
+	uint64_t count;
+	uint64_t capacity;
+	uint64_t keys;
+	uint64_t lookups;
+	uint64_t hits;
+} CTObjectInternTable, * CTObjectInternTableRef;
+
+/**
+ * How well a CTObjectInternTable has been doing.
+ **/
+typedef struct
+{
+	uint64_t lookups;
+	uint64_t hits;
+	uint64_t objects;
+	uint64_t keys;
+	double hit_rate;
+} CTObjectInternStats;
+
+/**
+ * Create a table to intern documents with.
+ * @param alloc		A properly initialised CTAllocator that was created with CTAllocatorCreate*. Only objects allocated with it are interned.
+ * @return			Returns an initialised CTObjectInternTable.
+ **/
+CTObjectInternTableRef CTObjectInternTableCreate(CTAllocatorRef restrict alloc);
+
+/**
+ * Collapse every subtree of a document that is equal to one already in the table, or elsewhere in the document, into a single shared instance. Dictionaries, arrays, strings, numbers and dictionary keys are interned bottom up, each one is frozen and looked up by an order-sensitive hash and an exact comparison, and duplicates are released in favour of the instance already in the table. Lookups are made once the elements of a dictionary or array have been interned, so comparing a candidate with the instance in the table mostly compares pointers.
+ * @param table		The table to intern into.
+ * @param object	The document to intern. The table takes ownership of it, and it may be released in favour of an equal one.
+ * @return			Returns the interned document, which is frozen and must be released with CTObjectRelease like any other.
+ **/
+CTObjectRef CTObjectIntern(CTObjectInternTableRef restrict table, CTObjectRef object);
+
+/**
+ * Report how many lookups a table has answered and how many of them found an equal object or key.
+ * @param table		The table to report on.
+ * @return			Returns the table's statistics.
+ **/
+CTObjectInternStats CTObjectInternTableGetStats(const CTObjectInternTable * restrict table);
+
+/**
+ * Release a table. The objects it has handed out stay valid, they are released once the documents holding them are.
+ * @param table		The table to release.
+ **/
+void CTObjectInternTableRelease(CTObjectInternTableRef table);
\ No newline at end of file
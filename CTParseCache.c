@@ -0,0 +1,229 @@
+//
+//  CTParseCache.c
+//  CTObject
+//
+//  Created by Carlo Tortorella on 17/10/26.
+//  Copyright (c) 2026 Carlo Tortorella. All rights reserved.
+//
+
+#include "CTParseCache.h"
+#include "CTBencode.h"
+#include "CTFunctions.h"
+#include <string.h>
+
+#define CTPARSE_CACHE_MINIMUM_CAPACITY 0x40
+
+typedef enum
+{
+	CTPARSE_CACHE_FORMAT_JSON,
+	CTPARSE_CACHE_FORMAT_BENCODE
+} CTPARSE_CACHE_FORMAT;
+
+CTParseCacheRef CTParseCacheCreate(CTAllocatorRef restrict alloc, uint64_t budget)
+{
+	CTParseCacheRef cache = CTAllocatorAllocate(alloc, sizeof(CTParseCache));
+	cache->alloc = alloc;
+	cache->budget = budget;
+	cache->capacity = CTPARSE_CACHE_MINIMUM_CAPACITY;
+	cache->buckets = CTAllocatorAllocate(alloc, sizeof(CTParseCacheEntry *) * cache->capacity);
+	pthread_mutex_init(&cache->lock, NULL);
+	return cache;
+}
+
+static CTParseCacheEntry ** CTParseCacheFind(CTParseCacheRef restrict cache, uint64_t hash, uint64_t format, const char * input, uint64_t length)
+{
+	// Returns the link to the matching entry, or the empty link at the end of its bucket
+	CTParseCacheEntry ** link = &cache->buckets[hash & (cache->capacity - 1)];
+	while (*link && !((*link)->hash == hash && (*link)->format == format && (*link)->length == length && !memcmp((*link)->input, input, length)))
+	{
+		link = &(*link)->next;
+	}
+	return link;
+}
+
+static void CTParseCacheUnlink(CTParseCacheRef restrict cache, CTParseCacheEntry * entry)
+{
+	if (entry->newer)
+	{
+		entry->newer->older = entry->older;
+	}
+	else
+	{
+		cache->newest = entry->older;
+	}
+	if (entry->older)
+	{
+		entry->older->newer = entry->newer;
+	}
+	else
+	{
+		cache->oldest = entry->newer;
+	}
+	entry->newer = entry->older = NULL;
+}
+
+static void CTParseCacheLinkNewest(CTParseCacheRef restrict cache, CTParseCacheEntry * entry)
+{
+	entry->older = cache->newest;
+	entry->newer = NULL;
+	if (cache->newest)
+	{
+		cache->newest->newer = entry;
+	}
+	else
+	{
+		cache->oldest = entry;
+	}
+	cache->newest = entry;
+}
+
+static void CTParseCacheGrow(CTParseCacheRef restrict cache)
+{
+	CTParseCacheEntry ** buckets = cache->buckets;
+	const uint64_t capacity = cache->capacity;
+	cache->capacity *= 2;
+	cache->buckets = CTAllocatorAllocate(cache->alloc, sizeof(CTParseCacheEntry *) * cache->capacity);
+	for (uint64_t i = 0; i < capacity; ++i)
+	{
+		while (buckets[i])
+		{
+			CTParseCacheEntry * entry = buckets[i];
+			buckets[i] = entry->next;
+			CTParseCacheEntry ** bucket = &cache->buckets[entry->hash & (cache->capacity - 1)];
+			entry->next = *bucket;
+			*bucket = entry;
+		}
+	}
+	CTAllocatorDeallocate(cache->alloc, buckets);
+}
+
+static void CTParseCacheEvict(CTParseCacheRef restrict cache, CTParseCacheEntry * entry)
+{
+	CTParseCacheEntry ** link = &cache->buckets[entry->hash & (cache->capacity - 1)];
+	while (*link != entry)
+	{
+		link = &(*link)->next;
+	}
+	*link = entry->next;
+	CTParseCacheUnlink(cache, entry);
+	--cache->count;
+	cache->bytes -= entry->bytes;
+	++cache->evictions;
+	// Callers still holding the document keep it alive, the cache only drops its own reference
+	CTObjectRelease(entry->object);
+	CTAllocatorDeallocate(cache->alloc, entry->input);
+	CTAllocatorDeallocate(cache->alloc, entry);
+}
+
+static CTObjectRef CTParseCacheInsert(CTParseCacheRef restrict cache, uint64_t hash, uint64_t format, const char * input, uint64_t length, CTObjectRef object)
+{
+	// Freezing and measuring walk the whole document, so they are done before taking the lock
+	CTObjectFreeze(object);
+	const uint64_t bytes = CTObjectDeepSize(object) + length + 1 + sizeof(CTParseCacheEntry);
+	pthread_mutex_lock(&cache->lock);
+	CTParseCacheEntry ** link = CTParseCacheFind(cache, hash, format, input, length);
+	if (*link)
+	{
+		// Another thread parsed the same input in the meantime, its document is the one everyone shares
+		CTObjectRef existing = CTObjectRetain((*link)->object);
+		pthread_mutex_unlock(&cache->lock);
+		CTObjectRelease(object);
+		return existing;
+	}
+	if (bytes <= cache->budget)
+	{
+		while (cache->oldest && cache->bytes + bytes > cache->budget)
+		{
+			CTParseCacheEvict(cache, cache->oldest);
+		}
+		if (cache->count >= cache->capacity)
+		{
+			CTParseCacheGrow(cache);
+		}
+		CTParseCacheEntry * entry = CTAllocatorAllocate(cache->alloc, sizeof(CTParseCacheEntry));
+		entry->hash = hash;
+		entry->format = format;
+		entry->length = length;
+		entry->input = CTAllocatorAllocateAligned(cache->alloc, length + 1, 0, CTAllocatorOptionsUninitialised);
+		memcpy(entry->input, input, length + 1);
+		entry->object = CTObjectRetain(object);
+		entry->bytes = bytes;
+		CTParseCacheEntry ** bucket = &cache->buckets[hash & (cache->capacity - 1)];
+		entry->next = *bucket;
+		*bucket = entry;
+		CTParseCacheLinkNewest(cache, entry);
+		++cache->count;
+		cache->bytes += bytes;
+	}
+	pthread_mutex_unlock(&cache->lock);
+	return object;
+}
+
+static CTObjectRef CTParseCacheParse(CTParseCacheRef restrict cache, CTPARSE_CACHE_FORMAT kind, CTJSONOptions options, const char * restrict input, CTErrorRef * error)
+{
+	// The same bytes parse differently with other options, so they are part of the key
+	const uint64_t format = (options << 1) | kind, length = strlen(input);
+	const uint64_t hash = hashMix(hashBytes(input, length) + format);
+	pthread_mutex_lock(&cache->lock);
+	CTParseCacheEntry * entry = *CTParseCacheFind(cache, hash, format, input, length);
+	if (entry)
+	{
+		++cache->hits;
+		CTParseCacheUnlink(cache, entry);
+		CTParseCacheLinkNewest(cache, entry);
+		CTObjectRef object = CTObjectRetain(entry->object);
+		pthread_mutex_unlock(&cache->lock);
+		return object;
+	}
+	++cache->misses;
+	pthread_mutex_unlock(&cache->lock);
+	// Parsing is done without the lock, so misses on different inputs never wait for each other
+	CTErrorRef parse_error = NULL;
+	CTObjectRef object = kind == CTPARSE_CACHE_FORMAT_JSON ? CTJSONParse(cache->alloc, input, options, &parse_error) : CTBencodeParse(cache->alloc, input, &parse_error);
+	if (parse_error || !object || object->type == CTOBJECT_NOT_AN_OBJECT)
+	{
+		if (error)
+		{
+			*error = parse_error;
+		}
+		else if (parse_error)
+		{
+			CTErrorRelease(parse_error);
+		}
+		return object;
+	}
+	return CTParseCacheInsert(cache, hash, format, input, length, object);
+}
+
+CTObjectRef CTJSONParseCached(CTParseCacheRef restrict cache, const char * restrict JSON, CTJSONOptions options, CTErrorRef * error)
+{
+	return CTParseCacheParse(cache, CTPARSE_CACHE_FORMAT_JSON, options, JSON, error);
+}
+
+CTObjectRef CTBencodeParseCached(CTParseCacheRef restrict cache, const char * restrict bencoded, CTErrorRef * error)
+{
+	return CTParseCacheParse(cache, CTPARSE_CACHE_FORMAT_BENCODE, 0, bencoded, error);
+}
+
+CTParseCacheStats CTParseCacheGetStats(CTParseCacheRef restrict cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	CTParseCacheStats stats = {cache->hits, cache->misses, cache->evictions, cache->count, cache->bytes};
+	pthread_mutex_unlock(&cache->lock);
+	return stats;
+}
+
+void CTParseCacheRelease(CTParseCacheRef cache)
+{
+	while (cache->newest)
+	{
+		CTParseCacheEntry * entry = cache->newest;
+		cache->newest = entry->older;
+		CTObjectRelease(entry->object);
+		CTAllocatorDeallocate(cache->alloc, entry->input);
+		CTAllocatorDeallocate(cache->alloc, entry);
+	}
+	pthread_mutex_destroy(&cache->lock);
+	CTAllocatorDeallocate(cache->alloc, cache->buckets);
+	CTAllocatorDeallocate(cache->alloc, cache);
+}
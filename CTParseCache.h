@@ -0,0 +1,101 @@
+//
+//  CTParseCache.h
+//  CTObject
+//
+//  Created by Carlo Tortorella on 17/10/26.
+//  Copyright (c) 2026 Carlo Tortorella. All rights reserved.
+//
+
+#pragma once
+#include "CTAllocator.h"
+#include "CTObject.h"
+#include "CTError.h"
+#include "CTJSON.h"
+#include <pthread.h>
+
+/**
+ * A parsed document kept by a CTParseCache, along with a copy of the input it was parsed from. Entries are chained in their bucket through next, and kept in least recently used order through newer and older.
+ **/
+typedef struct CTParseCacheEntry
+{
+	uint64_t hash;
+	uint64_t format;
+	uint64_t length;
+	char * input;
+	CTObjectRef object;
+	uint64_t bytes;
+	struct CTParseCacheEntry * next;
+	struct CTParseCacheEntry * newer;
+	struct CTParseCacheEntry * older;
+} CTParseCacheEntry;
+
+/**
+ * A cache of parsed documents keyed by a hash of the bytes they were parsed from, so that repeated payloads such as heartbeats skip the parser. Documents are frozen and shared by everyone who parses the same input, see CTObjectFreeze, and the least recently used ones are released once the cache outgrows its budget. Caches can be used from several threads at once.
+ **/
+typedef struct
+{
+	CTAllocatorRef alloc;
+	pthread_mutex_t lock;
+	CTParseCacheEntry ** buckets;
+	uint64_t capacity;
+	uint64_t count;
+	uint64_t bytes;
+	uint64_t budget;
+	CTParseCacheEntry * newest;
+	CTParseCacheEntry * oldest;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} CTParseCache, * CTParseCacheRef;
+
+/**
+ * How well a CTParseCache has been doing. bytes is the memory held by the documents in the cache and the inputs they were parsed from, see CTObjectDeepSize.
+ **/
+typedef struct
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t entries;
+	uint64_t bytes;
+} CTParseCacheStats;
+
+/**
+ * Create a parse cache.
+ * @param alloc		A properly initialised CTAllocator that was created with CTAllocatorCreate*. Documents are parsed into it, and as they are released by whichever thread drops the last reference, it must be created with CTAllocatorCreateShared if the cache is used from several threads.
+ * @param budget	The number of bytes the cached documents and their inputs may take up. Documents larger than the budget are parsed but not cached.
+ * @return			Returns an initialised CTParseCache.
+ **/
+CTParseCacheRef CTParseCacheCreate(CTAllocatorRef restrict alloc, uint64_t budget);
+
+/**
+ * Parse JSON through a cache. Input that was parsed before with the same options returns the same document without being parsed again, otherwise it is parsed with CTJSONParse and cached, unless it failed to parse.
+ * @param cache		The cache to look the input up in.
+ * @param JSON		The JSON to parse.
+ * @param options	The options to parse with, see CTJSONParse.
+ * @param error		A CTErrorRef pointer that receives the parser's error, or NULL.
+ * @return			Returns a frozen document to release with CTObjectRelease, which may be shared with other callers. Documents that failed to parse are returned as CTJSONParse returns them and are not frozen.
+ **/
+CTObjectRef CTJSONParseCached(CTParseCacheRef restrict cache, const char * restrict JSON, CTJSONOptions options, CTErrorRef * error);
+
+/**
+ * Parse bencoded data through a cache, in the same way as CTJSONParseCached.
+ * @param cache		The cache to look the input up in.
+ * @param bencoded	The bencoded data to parse.
+ * @param error		A CTErrorRef pointer that receives the parser's error, or NULL.
+ * @return			Returns a frozen document to release with CTObjectRelease, which may be shared with other callers.
+ **/
+CTObjectRef CTBencodeParseCached(CTParseCacheRef restrict cache, const char * restrict bencoded, CTErrorRef * error);
+
+/**
+ * Report how many lookups a cache has answered, and what it holds.
+ * @param cache	The cache to report on.
+ * @return		Returns the cache's statistics.
+ **/
+CTParseCacheStats CTParseCacheGetStats(CTParseCacheRef restrict cache);
+
+/**
+ * Release a cache. Documents returned by it stay valid until they are released. No thread may be using the cache.
+ * @param cache	The cache to release.
+ **/
+void CTParseCacheRelease(CTParseCacheRef cache);
@@ -0,0 +1,318 @@
+//
+//  CTPath.c
+//  CTObject
+//
+//  Created by Carlo Tortorella on 17/10/26.
+//  Copyright (c) 2026 Carlo Tortorella. All rights reserved.
+//
+
+#include "CTPath.h"
+#include "CTFunctions.h"
+#include "CTDictionary.h"
+#include "CTArray.h"
+#include <string.h>
+#include <ctype.h>
+
+static CTPathStep * CTPathAddStep(CTPathRef restrict path, CTPATH_STEP_TYPE type)
+{
+	path->steps = CTAllocatorReallocate(path->alloc, path->steps, sizeof(CTPathStep) * (path->count + 1));
+	CTPathStep * step = &path->steps[path->count++];
+	memset(step, 0, sizeof(CTPathStep));
+	step->type = type;
+	step->index = CT_NOT_FOUND;
+	if (type == CTPATH_STEP_WILDCARD)
+	{
+		++path->wildcards;
+	}
+	return step;
+}
+
+static void CTPathAddMember(CTPathRef restrict path, const char * key, uint64_t length, uint64_t index)
+{
+	CTPathStep * step = CTPathAddStep(path, CTPATH_STEP_MEMBER);
+	step->index = index;
+	if (key)
+	{
+		// Keys are hashed the way CTStringHash hashes dictionary keys, so a lookup mostly compares hashes
+		step->key = CTAllocatorAllocate(path->alloc, length + 1);
+		memcpy(step->key, key, length);
+		step->length = length;
+		step->hash = CTStringCharHash(step->key);
+	}
+}
+
+static uint64_t CTPathIndex(const char * characters, uint64_t length)
+{
+	// Indices are decimal without leading zeroes, anything else is only a key
+	if (!length || length > 19 || (length > 1 && *characters == '0'))
+	{
+		return CT_NOT_FOUND;
+	}
+	uint64_t index = 0;
+	for (uint64_t i = 0; i < length; ++i)
+	{
+		if (!isdigit(characters[i]))
+		{
+			return CT_NOT_FOUND;
+		}
+		index = index * 10 + characters[i] - '0';
+	}
+	return index;
+}
+
+static uint8_t CTPathParsePointer(CTPathRef restrict path, const char * expression)
+{
+	// Segments are unescaped into a buffer as long as the whole expression, which none of them can outgrow
+	char * segment = CTAllocatorAllocate(path->alloc, strlen(expression) + 1);
+	uint8_t valid = 1;
+	while (*expression && valid)
+	{
+		uint64_t length = 0;
+		for (++expression; *expression && *expression != '/'; ++expression)
+		{
+			if (*expression == '~')
+			{
+				if (expression[1] != '0' && expression[1] != '1')
+				{
+					valid = 0;
+					break;
+				}
+				segment[length++] = *++expression == '0' ? '~' : '/';
+			}
+			else
+			{
+				segment[length++] = *expression;
+			}
+		}
+		if (length == 1 && *segment == '*')
+		{
+			CTPathAddStep(path, CTPATH_STEP_WILDCARD);
+		}
+		else
+		{
+			CTPathAddMember(path, segment, length, CTPathIndex(segment, length));
+		}
+	}
+	CTAllocatorDeallocate(path->alloc, segment);
+	return valid;
+}
+
+static uint8_t CTPathParseJSONPath(CTPathRef restrict path, const char * expression)
+{
+	while (*expression)
+	{
+		if (*expression == '.')
+		{
+			++expression;
+			if (*expression == '*')
+			{
+				CTPathAddStep(path, CTPATH_STEP_WILDCARD);
+				++expression;
+				continue;
+			}
+			const uint64_t length = strcspn(expression, ".[");
+			if (!length)
+			{
+				return 0;
+			}
+			CTPathAddMember(path, expression, length, CT_NOT_FOUND);
+			expression += length;
+		}
+		else if (*expression == '[')
+		{
+			++expression;
+			if (*expression == '*')
+			{
+				CTPathAddStep(path, CTPATH_STEP_WILDCARD);
+				++expression;
+			}
+			else if (*expression == '\'' || *expression == '"')
+			{
+				const char * end = strchr(expression + 1, *expression);
+				if (!end)
+				{
+					return 0;
+				}
+				CTPathAddMember(path, expression + 1, end - expression - 1, CT_NOT_FOUND);
+				expression = end + 1;
+			}
+			else
+			{
+				const uint64_t length = strcspn(expression, "]");
+				const uint64_t index = CTPathIndex(expression, length);
+				if (index == CT_NOT_FOUND)
+				{
+					return 0;
+				}
+				CTPathAddMember(path, NULL, 0, index);
+				expression += length;
+			}
+			if (*expression++ != ']')
+			{
+				return 0;
+			}
+		}
+		else
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+CTPathRef CTPathCreate(CTAllocatorRef restrict alloc, const char * restrict expression, CTErrorRef * error)
+{
+	CTPathRef path = CTAllocatorAllocate(alloc, sizeof(CTPath));
+	path->alloc = alloc;
+	uint8_t valid = 1;
+	if (*expression == '/')
+	{
+		valid = CTPathParsePointer(path, expression);
+	}
+	else if (*expression == '$')
+	{
+		valid = CTPathParseJSONPath(path, expression + 1);
+	}
+	else if (*expression)
+	{
+		valid = 0;
+	}
+	if (!valid)
+	{
+		if (error)
+		{
+			*error = CTErrorCreate(alloc, "Path is neither a JSON Pointer nor a JSONPath", CTPATH_SYNTAX_ERROR);
+		}
+		CTPathRelease(path);
+		return NULL;
+	}
+	return path;
+}
+
+void CTPathRelease(CTPathRef path)
+{
+	for (uint64_t i = 0; i < path->count; ++i)
+	{
+		CTAllocatorDeallocate(path->alloc, path->steps[i].key);
+	}
+	CTAllocatorDeallocate(path->alloc, path->steps);
+	CTAllocatorDeallocate(path->alloc, path);
+}
+
+static inline const CTObject * CTPathStepChild(const CTObject * restrict object, const CTPathStep * restrict step)
+{
+	if (object->type == CTOBJECT_TYPE_DICTIONARY && step->key)
+	{
+		const CTDictionary * dict = object->ptr;
+		for (uint64_t i = 0; i < dict->count; ++i)
+		{
+			CTStringRef key = dict->elements[i]->key;
+			if (CTStringHash(key) == step->hash && key->length == step->length && !memcmp(key->characters, step->key, step->length))
+			{
+				return dict->elements[i]->value;
+			}
+		}
+	}
+	else if (object->type == CTOBJECT_TYPE_ARRAY)
+	{
+		const CTArray * array = object->ptr;
+		if (step->index < array->count)
+		{
+			return array->elements[step->index];
+		}
+	}
+	return NULL;
+}
+
+CTObjectRef CTPathEvaluate(const CTPath * restrict path, const CTObject * restrict object)
+{
+	if (path->wildcards)
+	{
+		CTPathIterator iterator;
+		CTPathIteratorInit(&iterator, path, object);
+		CTObjectRef first = CTPathIteratorNext(&iterator);
+		CTPathIteratorRelease(&iterator);
+		return first;
+	}
+	for (uint64_t i = 0; i < path->count && object; ++i)
+	{
+		object = CTPathStepChild(object, &path->steps[i]);
+	}
+	return (CTObjectRef)object;
+}
+
+void CTPathIteratorInit(CTPathIterator * restrict iterator, const CTPath * restrict path, const CTObject * restrict object)
+{
+	iterator->path = path;
+	iterator->root = object;
+	iterator->started = 0;
+	iterator->frames = iterator->inline_frames;
+	iterator->depth = 0;
+	iterator->capacity = CTPATH_ITERATOR_INLINE_FRAMES;
+}
+
+CTObjectRef CTPathIteratorNext(CTPathIterator * restrict iterator)
+{
+	const CTPath * path = iterator->path;
+	const CTObject * object = NULL;
+	uint64_t step = 0;
+	if (!iterator->started)
+	{
+		iterator->started = 1;
+		object = iterator->root;
+	}
+	for (;;)
+	{
+		// Move on to the next element of the innermost wildcard, leaving those that have none left
+		while (!object && iterator->depth)
+		{
+			CTPathIteratorFrame * frame = &iterator->frames[iterator->depth - 1];
+			if (frame->container->type == CTOBJECT_TYPE_DICTIONARY)
+			{
+				const CTDictionary * dict = frame->container->ptr;
+				object = frame->position < dict->count ? dict->elements[frame->position]->value : NULL;
+			}
+			else
+			{
+				const CTArray * array = frame->container->ptr;
+				object = frame->position < array->count ? array->elements[frame->position] : NULL;
+			}
+			if (object)
+			{
+				++frame->position;
+				step = frame->step + 1;
+			}
+			else
+			{
+				--iterator->depth;
+			}
+		}
+		if (!object)
+		{
+			return NULL;
+		}
+		while (object && step < path->count && path->steps[step].type == CTPATH_STEP_MEMBER)
+		{
+			object = CTPathStepChild(object, &path->steps[step++]);
+		}
+		if (object && step == path->count)
+		{
+			return (CTObjectRef)object;
+		}
+		if (object && (object->type == CTOBJECT_TYPE_DICTIONARY || object->type == CTOBJECT_TYPE_ARRAY))
+		{
+			if (iterator->depth == iterator->capacity)
+			{
+				iterator->frames = stackGrow(iterator->frames, iterator->inline_frames, &iterator->capacity, sizeof(CTPathIteratorFrame));
+			}
+			iterator->frames[iterator->depth++] = (CTPathIteratorFrame){object, 0, step};
+		}
+		object = NULL;
+	}
+}
+
+void CTPathIteratorRelease(CTPathIterator * restrict iterator)
+{
+	stackRelease(iterator->frames, iterator->inline_frames);
+	iterator->frames = iterator->inline_frames;
+}
@@ -0,0 +1,115 @@
+//
+//  CTPath.h
+//  CTObject
+//
+//  Created by Carlo Tortorella on 17/10/26.
+//  Copyright (c) 2026 Carlo Tortorella. All rights reserved.
+//
+
+#pragma once
+#include "CTAllocator.h"
+#include "CTObject.h"
+#include "CTError.h"
+
+enum CTPATH_ERROR_CODES
+{
+	CTPATH_SYNTAX_ERROR = -300
+};
+
+typedef enum
+{
+	CTPATH_STEP_MEMBER,
+	CTPATH_STEP_WILDCARD
+} CTPATH_STEP_TYPE;
+
+/**
+ * A step of a CTPath. Member steps look up key in dictionaries, by its hash first, and index in arrays. Either can be missing, key is NULL for steps such as [0] that only apply to arrays, and index is CT_NOT_FOUND for keys that are not array indices. Wildcard steps go through every value of a dictionary or element of an array.
+ **/
+typedef struct
+{
+	CTPATH_STEP_TYPE type;
+	char * key;
+	uint64_t length;
+	hash_t hash;
+	uint64_t index;
+} CTPathStep;
+
+/**
+ * A path into nested dictionaries and arrays, compiled once by CTPathCreate and evaluated against any number of documents.
+ **/
+typedef struct
+{
+	CTAllocatorRef alloc;
+	CTPathStep * steps;
+	uint64_t count;
+	uint64_t wildcards;
+} CTPath, * CTPathRef;
+
+#define CTPATH_ITERATOR_INLINE_FRAMES 0x8
+
+typedef struct
+{
+	const CTObject * container;
+	uint64_t position;
+	uint64_t step;
+} CTPathIteratorFrame;
+
+/**
+ * Walks the objects a path with wildcards leads to, one at a time, without collecting them into an array. Iterators live wherever the caller puts them, usually on the stack, and only allocate for paths with more than CTPATH_ITERATOR_INLINE_FRAMES wildcards.
+ **/
+typedef struct
+{
+	const CTPath * path;
+	const CTObject * root;
+	uint8_t started;
+	CTPathIteratorFrame * frames;
+	uint64_t depth;
+	uint64_t capacity;
+	CTPathIteratorFrame inline_frames[CTPATH_ITERATOR_INLINE_FRAMES];
+} CTPathIterator;
+
+/**
+ * Compile a path expression. Keys are hashed and indices parsed here, so evaluating the path never hashes a key again. Two syntaxes are understood:
+ * JSON Pointers such as /r/d/0/i, see RFC 6901, where "~0" and "~1" stand for '~' and '/', a segment of * is a wildcard, and segments that are numbers index arrays as well as name dictionary keys.
+ * JSONPath-like expressions such as $.r.d[0].i, made of .key, ['key'], [index], .* and [*] steps.
+ * @param alloc			A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param expression	The expression to compile. The empty string is the path to the whole document.
+ * @param error			A CTErrorRef pointer that receives an error with CTPATH_SYNTAX_ERROR if the expression cannot be compiled, or NULL.
+ * @return				Returns the compiled CTPath, or NULL if the expression cannot be compiled.
+ **/
+CTPathRef CTPathCreate(CTAllocatorRef restrict alloc, const char * restrict expression, CTErrorRef * error);
+
+/**
+ * Release a path and its steps.
+ * @param path	A path created with CTPathCreate.
+ **/
+void CTPathRelease(CTPathRef path);
+
+/**
+ * Find the object a path leads to. Documents are only read, never modified, so frozen documents can be evaluated from many threads at once.
+ * @param path		A path created with CTPathCreate.
+ * @param object	The document to evaluate the path against.
+ * @return			Returns the object the path leads to, or the first of them for paths with wildcards, or NULL if there is none. The object belongs to the document.
+ **/
+CTObjectRef CTPathEvaluate(const CTPath * restrict path, const CTObject * restrict object);
+
+/**
+ * Start iterating over the objects a path leads to.
+ * @param iterator	The iterator to initialise.
+ * @param path		A path created with CTPathCreate, which must outlive the iterator.
+ * @param object	The document to evaluate the path against, which must not be modified while it is iterated over.
+ **/
+void CTPathIteratorInit(CTPathIterator * restrict iterator, const CTPath * restrict path, const CTObject * restrict object);
+
+/**
+ * Move an iterator on to the next object the path leads to, in the order of the elements of the dictionaries and arrays on the way.
+ * @param iterator	An iterator initialised with CTPathIteratorInit.
+ * @return			Returns the next object, which belongs to the document, or NULL once there are no more.
+ **/
+CTObjectRef CTPathIteratorNext(CTPathIterator * restrict iterator);
+
+/**
+ * Release the memory an iterator took for paths with many wildcards. The iterator must be initialised again before it is used again.
+ * @param iterator	An iterator initialised with CTPathIteratorInit.
+ **/
+void CTPathIteratorRelease(CTPathIterator * restrict iterator);
@@ -19,6 +19,8 @@
 #include "CTNull.h"
 #include "CTNumber.h"
 #include "CTObject.h"
+#include "CTParseCache.h"
+#include "CTPath.h"
 #include "CTString.h"
 
 #ifdef __OBJC__
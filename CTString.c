@@ -11,6 +11,24 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <assert.h>
+
+static inline uint8_t CTStringCharactersInline(const CTString * restrict string)
+{
+	// Strings embedded in an object by CTObjectWithCharacters keep their characters right behind them, in the object's allocation
+	return string->characters == (const char *)(string + 1);
+}
+
+static char * CTStringResizeCharacters(CTStringRef restrict string, uint64_t size)
+{
+	if (CTStringCharactersInline(string))
+	{
+		char * characters = bufferAllocate(string->alloc, size);
+		memcpy(characters, string->characters, string->length + 1);
+		return characters;
+	}
+	return bufferReallocate(string->alloc, string->characters, size);
+}
 
 CTStringRef CTStringCreate(CTAllocatorRef restrict alloc, const char * restrict characters)
 {
@@ -33,10 +51,22 @@ CTStringRef CTStringCopy(CTAllocatorRef restrict alloc, const CTString * string)
 
 void CTStringRelease(CTStringRef string)
 {
+	if (referencesRelease(&string->references))
+	{
+		return;
+	}
     CTAllocatorDeallocate(string->alloc, string->characters);
     CTAllocatorDeallocate(string->alloc, string);
 }
 
+void CTStringReleaseEmbedded(CTStringRef string)
+{
+	if (!CTStringCharactersInline(string))
+	{
+		CTAllocatorDeallocate(string->alloc, string->characters);
+	}
+}
+
 inline const char * CTStringUTF8String(const CTString * restrict string)
 {
 	return string->characters;
@@ -75,8 +105,9 @@ hash_t CTStringCharHash(const char * restrict string)
 
 void CTStringPrependCharacters(CTStringRef restrict string, const char * restrict characters, int64_t limit)
 {
+	assert(!string->references);
 	const uint64_t length = limit < 0 ? strlen(characters) : limit;
-	string->characters = CTAllocatorReallocate(string->alloc, string->characters, string->length + length + 1);
+	string->characters = CTStringResizeCharacters(string, string->length + length + 1);
 	memmove(string->characters + length, string->characters, string->length + 1);
 	memcpy(string->characters, characters, length);
 	string->length += length;
@@ -85,7 +116,8 @@ void CTStringPrependCharacters(CTStringRef restrict string, const char * restric
 
 void CTStringPrependCharacter(CTStringRef restrict string, char character)
 {
-	string->characters = CTAllocatorReallocate(string->alloc, string->characters, string->length + 2);
+	assert(!string->references);
+	string->characters = CTStringResizeCharacters(string, string->length + 2);
 	memmove(string->characters + 1, string->characters, string->length + 1);
 	string->characters[0] = character;
 	++string->length;
@@ -94,8 +126,9 @@ void CTStringPrependCharacter(CTStringRef restrict string, char character)
 
 void CTStringAppendCharacters(CTStringRef restrict string, const char * restrict characters, int64_t limit)
 {
+	assert(!string->references);
 	const uint64_t length = limit < 0 ? strlen(characters) : limit;
-	string->characters = CTAllocatorReallocate(string->alloc, string->characters, CTStringLength(string) + length + 1);
+	string->characters = CTStringResizeCharacters(string, CTStringLength(string) + length + 1);
 	memcpy(string->characters + string->length, characters, length);
 	string->length += length;
 	string->characters[string->length] = 0;
@@ -107,7 +140,8 @@ void CTStringAppendCharacters(CTStringRef restrict string, const char * restrict
 
 void CTStringAppendCharacter(CTStringRef restrict string, char character)
 {
-	string->characters = CTAllocatorReallocate(string->alloc, string->characters, string->length + 2);
+	assert(!string->references);
+	string->characters = CTStringResizeCharacters(string, string->length + 2);
 	string->characters[string->length] = character;
 	++string->length;
 	string->characters[string->length] = 0;
@@ -116,7 +150,11 @@ void CTStringAppendCharacter(CTStringRef restrict string, char character)
 
 void CTStringSet(CTStringRef restrict string, const char * restrict characters)
 {
-    CTAllocatorDeallocate(string->alloc, string->characters);
+	assert(!string->references);
+	if (!CTStringCharactersInline(string))
+	{
+		CTAllocatorDeallocate(string->alloc, string->characters);
+	}
     string->characters = stringDuplicate(string->alloc, characters);
     CTStringSetLength(string, strlen(characters));
 	string->modified = 1;
@@ -124,15 +162,22 @@ void CTStringSet(CTStringRef restrict string, const char * restrict characters)
 
 void CTStringRemoveCharactersFromStart(CTStringRef restrict string, unsigned long count)
 {
+	assert(!string->references);
     if (count < CTStringLength(string))
     {
 		memmove(string->characters, string->characters + count, string->length - count + 1);
-		CTAllocatorReallocate(string->alloc, string->characters, string->length - count + 1);
+		if (!CTStringCharactersInline(string))
+		{
+			string->characters = CTAllocatorReallocate(string->alloc, string->characters, string->length - count + 1);
+		}
 		string->length -= count;
     }
     else
     {
-        string->characters = CTAllocatorReallocate(string->alloc, string->characters, 1);
+		if (!CTStringCharactersInline(string))
+		{
+			string->characters = CTAllocatorReallocate(string->alloc, string->characters, 1);
+		}
 		string->characters[0] = 0;
 		string->length = 0;
     }
@@ -141,15 +186,22 @@ void CTStringRemoveCharactersFromStart(CTStringRef restrict string, unsigned lon
 
 void CTStringRemoveCharactersFromEnd(CTStringRef restrict string, unsigned long count)
 {
+	assert(!string->references);
     if (count < CTStringLength(string))
     {
-		CTAllocatorReallocate(string->alloc, string->characters, string->length - count + 1);
+		if (!CTStringCharactersInline(string))
+		{
+			string->characters = CTAllocatorReallocate(string->alloc, string->characters, string->length - count + 1);
+		}
 		string->characters[string->length - count] = 0;
 		string->length -= count;
     }
     else
     {
-        string->characters = CTAllocatorReallocate(string->alloc, string->characters, 1);
+		if (!CTStringCharactersInline(string))
+		{
+			string->characters = CTAllocatorReallocate(string->alloc, string->characters, 1);
+		}
 		string->characters[0] = 0;
 		string->length = 0;
     }
@@ -163,6 +215,7 @@ void CTStringAppendString(CTStringRef restrict string1, const CTString * restric
 
 void CTStringToUpper(CTStringRef restrict string)
 {
+	assert(!string->references);
 	for (uint64_t i = 0; i < CTStringLength(string); ++i)
 	{
 		string->characters[i] = toupper(string->characters[i]);
@@ -172,6 +225,7 @@ void CTStringToUpper(CTStringRef restrict string)
 
 void CTStringToLower(CTStringRef restrict string)
 {
+	assert(!string->references);
 	for (uint64_t i = 0; i < CTStringLength(string); ++i)
 	{
 		string->characters[i] = tolower(string->characters[i]);
@@ -192,8 +246,10 @@ const char * CTStringStringBetween(const CTString * restrict string, const char
 		}
 		if (ret1 < ret2)
 		{
-			char * retVal = CTAllocatorAllocate(string->alloc, ret2 - (ret1 + strlen(search1)));
-			strncpy(retVal, ret1 + strlen(search1), ret2 - (ret1 + strlen(search1)));
+			uint64_t length = ret2 - (ret1 + strlen(search1));
+			char * retVal = bufferAllocate(string->alloc, length + 1);
+			memcpy(retVal, ret1 + strlen(search1), length);
+			retVal[length] = 0;
 			return retVal;
 		}
 		index = ret1 - CTStringUTF8String(string);
@@ -233,11 +289,41 @@ uint8_t CTStringIsEqual2(CTString * restrict string1, const char * restrict stri
 	return CTStringHash(string1) == CTStringCharHash(string2);
 }
 
+uint8_t CTStringIsIdentical(const CTString * restrict string1, const CTString * restrict string2)
+{
+	return string1 == string2 || (CTStringLength(string1) == CTStringLength(string2) && !memcmp(CTStringUTF8String(string1), CTStringUTF8String(string2), CTStringLength(string1)));
+}
+
 CTObjectRef CTObjectWithString(CTAllocatorRef alloc, CTString * restrict str)
 {
 	return CTObjectCreate(alloc, str, CTOBJECT_TYPE_STRING);
 }
 
+CTObjectRef CTObjectWithCharacters(CTAllocatorRef restrict alloc, const char * restrict characters, uint64_t length)
+{
+	CTObjectRef object;
+	CTStringRef string;
+	if (sizeof(CTObject) + sizeof(CTString) + length + 1 <= CTALLOCATOR_SIZE_CLASSES * 0x10)
+	{
+		object = CTObjectCreateWithEmbeddedValue(alloc, sizeof(CTString) + length + 1, CTOBJECT_TYPE_STRING);
+		string = object->ptr;
+		string->characters = (char *)(string + 1);
+	}
+	else
+	{
+		string = CTAllocatorAllocate(alloc, sizeof(CTString));
+		string->characters = bufferAllocate(alloc, length + 1);
+		object = CTObjectWithString(alloc, string);
+	}
+	string->alloc = alloc;
+	string->length = length;
+	string->references = 0;
+	string->modified = 1;
+	memcpy(string->characters, characters, length);
+	string->characters[length] = 0;
+	return object;
+}
+
 CTStringRef CTStringReplaceCharacterWithCharacters(CTAllocatorRef alloc, const CTString * restrict string, const char * (^repFn)(const char))
 {
 	CTStringRef ret_val = CTStringCreate(alloc, "");
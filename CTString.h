@@ -21,11 +21,17 @@ typedef struct
     char * characters;
 	uint64_t hash;
 	uint8_t modified;
+	uint64_t references;
 } CTString, * CTStringRef;
 
 CTStringRef CTStringCreate(CTAllocatorRef restrict alloc, const char * restrict characters);
 CTStringRef CTStringCopy(CTAllocatorRef restrict alloc, const CTString * string);
 void CTStringRelease(CTStringRef string);
+/**
+ * Release the characters of a string embedded in an object, if they have outgrown the object's allocation. The string itself is released along with the object, see CTObjectRelease.
+ * @param string	A string created by CTObjectWithCharacters.
+ **/
+void CTStringReleaseEmbedded(CTStringRef string);
 
 hash_t CTStringCharHash(const char * restrict string);
 
@@ -51,6 +57,11 @@ int8_t CTStringCompare(CTString * restrict string1, CTString * restrict string2)
 int8_t CTStringCompare2(CTString * restrict string1, const char * restrict string2);
 uint8_t CTStringIsEqual(CTString * restrict string1, CTString * restrict string2);
 uint8_t CTStringIsEqual2(CTString * restrict string1, const char * restrict string2);
+/**
+ * Compare two strings byte for byte, where CTStringCompare and CTStringIsEqual only compare their hashes.
+ * @return	A value indicating equality, 0 = false, 1 = true.
+ **/
+uint8_t CTStringIsIdentical(const CTString * restrict string1, const CTString * restrict string2);
 CTStringRef CTStringReplaceCharacterWithCharacters(CTAllocatorRef alloc, const CTString * restrict string, const char * (^repFn)(const char));
 
 /**
@@ -58,4 +69,13 @@ CTStringRef CTStringReplaceCharacterWithCharacters(CTAllocatorRef alloc, const C
  * @param str	A properly initialised CTString that was created with CTStringCreate.
  * @return		The CTString wrapped in a CTObject. The result is identical to using CTObjectCreate.
  **/
-CTObjectRef CTObjectWithString(CTAllocatorRef alloc, CTString * restrict str);
\ No newline at end of file
+CTObjectRef CTObjectWithString(CTAllocatorRef alloc, CTString * restrict str);
+
+/**
+ * Return a CTObject holding a copy of the characters passed. Short strings are embedded in the object along with their characters, so the whole string takes a single small allocation, longer ones are allocated as with CTObjectWithString.
+ * @param alloc			A properly initialised CTAllocator that was created with CTAllocatorCreate*.
+ * @param characters	The characters to copy, which need not be null terminated.
+ * @param length		The number of characters to copy.
+ * @return				A CTObject of type CTOBJECT_TYPE_STRING.
+ **/
+CTObjectRef CTObjectWithCharacters(CTAllocatorRef restrict alloc, const char * restrict characters, uint64_t length);
\ No newline at end of file